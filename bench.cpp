@@ -0,0 +1,374 @@
+#include "grid.h"
+#include <cstdio>
+#include <filesystem>
+
+// Benchmark of the cascade engine on synthetic grids. Every grid is drawn
+// from a seeded Philox stream, so a run is reproducible from its seed.
+
+// Heap allocations made by the process, counted by replacing the global
+// operator new, so each measurement can report how often it allocates.
+// GCC cannot pair the replaced new and delete once they are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+atomic<uint64_t> heapAllocations{0};
+
+void* operator new(size_t bytes) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(bytes ? bytes : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+void* operator new(size_t bytes, align_val_t align) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+#ifdef _WIN32
+    if (void* p = _aligned_malloc(bytes ? bytes : 1, a)) return p;
+#else
+    if (void* p = aligned_alloc(a, (bytes + a - 1) / a * a)) return p;
+#endif
+    throw bad_alloc();
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+void operator delete(void* p, size_t, align_val_t align) noexcept { operator delete(p, align); }
+
+// Builds a grid with random ratings and loads, rejecting repeated lines
+class GridBuilder {
+private:
+    Graph grid;
+    Philox4x32 rng;
+    unordered_set<long long> keys;
+
+    double between(double lo, double hi) { return lo + (hi - lo) * rng.uniform(); }
+
+public:
+    GridBuilder(int n, uint64_t seed, uint64_t stream) : grid(n), rng(seed, stream) {
+        grid.setVerbose(false);
+        for (int i = 0; i < n; i++) {
+            double capacity = between(100, 300);
+            grid.addNode(i, "N" + to_string(i), capacity * between(0.4, 0.8), capacity);
+        }
+    }
+
+    double uniform() { return rng.uniform(); }
+    int below(int n) { return min(n - 1, static_cast<int>(rng.uniform() * n)); }
+
+    // Add a line between u and v unless there is one already
+    bool link(int u, int v) {
+        if (u == v || !keys.insert(static_cast<long long>(min(u, v)) << 32 | max(u, v)).second) return false;
+        double capacity = between(50, 150);
+        return grid.addEdge(u, v, capacity, capacity * between(0.3, 0.7), between(0.5, 1.5));
+    }
+
+    Graph take() { return move(grid); }
+};
+
+// Rows of a square-ish lattice, each node linked right and down
+Graph makeLattice(int n, uint64_t seed) {
+    GridBuilder b(n, seed, 1);
+    int cols = static_cast<int>(ceil(sqrt(static_cast<double>(n))));
+    for (int i = 0; i < n; i++) {
+        if ((i + 1) % cols != 0 && i + 1 < n) b.link(i, i + 1);
+        if (i + cols < n) b.link(i, i + cols);
+    }
+    return b.take();
+}
+
+// A tree fed from node 0: mostly long feeders, with laterals branching off
+// recent nodes
+Graph makeRadial(int n, uint64_t seed) {
+    GridBuilder b(n, seed, 2);
+    for (int i = 1; i < n; i++) {
+        int parent = b.uniform() < 0.85 ? i - 1 : i - 1 - b.below(min(i, 50));
+        b.link(parent, i);
+    }
+    return b.take();
+}
+
+// Preferential attachment: each new node links to two earlier ones, chosen
+// in proportion to their degree
+Graph makeScaleFree(int n, uint64_t seed) {
+    GridBuilder b(n, seed, 3);
+    vector<int> ends; // Each line's endpoints, so a draw is degree-weighted
+    for (int i = 0; i < min(n, 3); i++) {
+        for (int j = 0; j < i; j++) {
+            b.link(j, i);
+            ends.push_back(i);
+            ends.push_back(j);
+        }
+    }
+    for (int i = 3; i < n; i++) {
+        int first = ends[b.below(static_cast<int>(ends.size()))];
+        int second = first;
+        while (second == first) second = ends[b.below(static_cast<int>(ends.size()))];
+        for (int t : {first, second}) {
+            b.link(t, i);
+            ends.push_back(t);
+            ends.push_back(i);
+        }
+    }
+    return b.take();
+}
+
+// Meshed transmission grid with IEEE test case statistics: about 1.6 lines
+// per bus, mostly between nearby buses, with a few long ties
+Graph makeIeeeLike(int n, uint64_t seed) {
+    GridBuilder b(n, seed, 4);
+    for (int i = 1; i < n; i++) {
+        b.link(i - 1 - b.below(min(i, 4)), i);
+        if (i >= 2 && b.uniform() < 0.55) b.link(i - 1 - b.below(min(i, 8)), i);
+        if (b.uniform() < 0.01) b.link(b.below(i), i);
+    }
+    return b.take();
+}
+
+struct GridKind {
+    const char* name;
+    Graph (*make)(int n, uint64_t seed);
+};
+
+const GridKind gridKinds[] = {
+    {"lattice", makeLattice},
+    {"radial", makeRadial},
+    {"scalefree", makeScaleFree},
+    {"ieee", makeIeeeLike},
+};
+
+// Repeats an operation at least minReps and at most maxReps times, stopping
+// after the time budget, and summarizes the latencies
+class Timer {
+private:
+    int minReps, maxReps;
+    double budget; // Seconds
+
+public:
+    vector<double> seconds;
+    uint64_t allocations = 0; // Heap allocations made by the operation over all repetitions
+
+    Timer(int minR, int maxR, double budgetSeconds) : minReps(minR), maxReps(maxR), budget(budgetSeconds) {}
+
+    template <typename F>
+    void run(F&& op) {
+        seconds.clear();
+        allocations = 0;
+        double total = 0;
+        for (int rep = 0; rep < maxReps && (rep < minReps || total < budget); rep++) {
+            auto start = chrono::steady_clock::now();
+            uint64_t before = heapAllocations.load(memory_order_relaxed);
+            op(rep);
+            allocations += heapAllocations.load(memory_order_relaxed) - before;
+            seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            total += seconds.back();
+        }
+    }
+
+    // Nearest-rank percentile, in milliseconds
+    double percentile(double p) const {
+        vector<double> sorted = seconds;
+        sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(ceil(p / 100.0 * sorted.size()));
+        return 1000 * sorted[rank ? rank - 1 : 0];
+    }
+
+    double mean() const {
+        double total = 0;
+        for (double s : seconds) total += s;
+        return total / seconds.size();
+    }
+};
+
+string fixed3(double v) {
+    ostringstream os;
+    os << fixed << setprecision(3) << v;
+    return os.str();
+}
+
+// Write one measurement as a JSON object; work is the amount done per repetition
+void writeMeasurement(ostream& out, bool& first, const char* kind, const Graph& grid, const string& op,
+                      const Timer& timer, double work, const char* unit) {
+    out << (first ? "\n" : ",\n") << "{\"grid\":\"" << kind << "\",\"nodes\":" << grid.getNumNodes()
+        << ",\"lines\":" << grid.getNumLines() << ",\"op\":\"" << op << "\",\"reps\":" << timer.seconds.size()
+        << ",\"mean_ms\":" << fixed3(1000 * timer.mean()) << ",\"p50_ms\":" << fixed3(timer.percentile(50))
+        << ",\"p90_ms\":" << fixed3(timer.percentile(90)) << ",\"p99_ms\":" << fixed3(timer.percentile(99))
+        << ",\"throughput\":" << fixed3(work / timer.mean()) << ",\"unit\":\"" << unit
+        << "\",\"allocs_per_rep\":" << fixed3(static_cast<double>(timer.allocations) / timer.seconds.size()) << "}";
+    first = false;
+}
+
+// Parse a comma-separated list of sizes such as 1e3,1e4
+bool parseSizes(const string& text, vector<int>& sizes) {
+    istringstream iss(text);
+    string item;
+    sizes.clear();
+    while (getline(iss, item, ',')) {
+        istringstream is(item);
+        double v;
+        if (!(is >> v) || !is.eof() || v < 10 || v > 1e8) return false;
+        sizes.push_back(static_cast<int>(v));
+    }
+    return !sizes.empty();
+}
+
+void printUsage(const char* prog) {
+    cout << "Usage: " << prog << " [--sizes N,...] [--grids KIND,...] [-s SEED] [-t N] [--reps N] [--budget SEC]\n"
+         << "             [--dir DIR] [-o OUT]\n"
+         << "  --sizes N,...    Grid sizes in nodes (default: 1e3,1e4,1e5,1e6; up to 1e8)\n"
+         << "  --grids KIND,... lattice, radial, scalefree, ieee (default: all)\n"
+         << "  -s SEED          Seed of the generated grids (default: 1)\n"
+         << "  -t N             Worker threads for N-1 screening (default: all cores)\n"
+         << "  --reps N         Most repetitions per measurement (default: 50)\n"
+         << "  --budget SEC     Stop repeating after SEC seconds and at least 3 repetitions (default: 1)\n"
+         << "  --dir DIR        Directory for the file I/O measurements (default: system temp)\n"
+         << "  -o OUT           Write the JSON report to OUT instead of standard output\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<int> sizes = {1000, 10000, 100000, 1000000};
+    vector<const GridKind*> kinds;
+    uint64_t seed = 1;
+    unsigned threads = 0;
+    int maxReps = 50;
+    double budget = 1;
+    string dir, outFile;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sizes" && hasValue) {
+            ok = parseSizes(argv[++i], sizes);
+        } else if (arg == "--grids" && hasValue) {
+            istringstream iss(argv[++i]);
+            string name;
+            while (ok && getline(iss, name, ',')) {
+                auto it = find_if(begin(gridKinds), end(gridKinds), [&](const GridKind& k) { return name == k.name; });
+                ok = it != end(gridKinds);
+                if (ok) kinds.push_back(it);
+            }
+        } else if (arg == "-s" && hasValue) {
+            istringstream is(argv[++i]);
+            ok = static_cast<bool>(is >> seed) && is.eof();
+        } else if (arg == "-t" && hasValue) {
+            istringstream is(argv[++i]);
+            ok = static_cast<bool>(is >> threads) && is.eof();
+        } else if (arg == "--reps" && hasValue) {
+            istringstream is(argv[++i]);
+            ok = static_cast<bool>(is >> maxReps) && is.eof() && maxReps > 0;
+        } else if (arg == "--budget" && hasValue) {
+            istringstream is(argv[++i]);
+            ok = static_cast<bool>(is >> budget) && is.eof() && budget >= 0;
+        } else if (arg == "--dir" && hasValue) {
+            dir = argv[++i];
+        } else if (arg == "-o" && hasValue) {
+            outFile = argv[++i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        printUsage(argv[0]);
+        return string(argc > 1 ? argv[1] : "") == "--help" ? 0 : 1;
+    }
+    if (kinds.empty()) {
+        for (const GridKind& k : gridKinds) kinds.push_back(&k);
+    }
+    if (dir.empty()) dir = filesystem::temp_directory_path().string();
+
+    ofstream file;
+    ostream* out = &cout;
+    if (!outFile.empty()) {
+        file.open(outFile);
+        if (!file) {
+            cout << "Error opening file: " << outFile << "\n";
+            return 1;
+        }
+        out = &file;
+    }
+    WorkStealingPool pool(threads ? threads : thread::hardware_concurrency());
+    *out << "{\"benchmark\":\"grid\",\"seed\":" << seed << ",\"threads\":" << pool.size() << ",\"kernels\":\""
+         << loadKernels().name << "\",\"results\":[";
+    bool first = true;
+    Timer timer(3, maxReps, budget);
+    for (int n : sizes) {
+        for (const GridKind* kind : kinds) {
+            // Generated once: at the largest sizes this takes as long as the rest
+            Graph grid(1);
+            Timer once(1, 1, 0);
+            once.run([&](int) { grid = kind->make(n, seed); });
+            grid.prepare(false);
+            double elements = grid.getNumNodes() + grid.getNumLines();
+            writeMeasurement(*out, first, kind->name, grid, "generate", once, elements, "elements/s");
+
+            // Random 30% load increases, one stream per repetition, each from
+            // the base state, run as a Monte Carlo worker runs its trials
+            GridState st = grid.getState();
+            CascadeOptions options;
+            options.loadIncreasePercent = 30;
+            options.randomLoad = true;
+            options.seed = seed;
+            options.islandTimeline = false;
+            CascadeScratch scratch;
+            CascadeResult result;
+            auto cascade = [&](int rep) {
+                options.trial = rep;
+                st.checkpoint();
+                grid.runCascade(st, options, scratch, result);
+                st.rollback();
+            };
+            timer.run(cascade);
+            writeMeasurement(*out, first, kind->name, grid, "cascade", timer, elements, "elements/s");
+
+            // The same trials again: with the buffers grown to fit them, nothing may allocate
+            int trials = static_cast<int>(timer.seconds.size());
+            Timer steady(trials, trials, 0);
+            steady.run(cascade);
+            writeMeasurement(*out, first, kind->name, grid, "cascade_steady", steady, elements, "elements/s");
+            if (steady.allocations) {
+                cout << "Error: steady-state cascades on " << kind->name << " " << n << " made "
+                     << steady.allocations << " heap allocations\n";
+                return 1;
+            }
+
+            timer.run([&](int) { grid.analyzeCriticalComponents(&pool); });
+            writeMeasurement(*out, first, kind->name, grid, "n1_screen", timer, grid.getNumLines(), "lines/s");
+
+            bool connected = true;
+            timer.run([&](int) { connected = grid.isConnected(st) && connected; });
+            writeMeasurement(*out, first, kind->name, grid, "connectivity", timer, grid.getNumNodes(), "nodes/s");
+
+            // File round trips in both formats
+            string base = dir + "/grid_bench_" + to_string(n) + "_" + kind->name;
+            for (const char* format : {"text", "snapshot"}) {
+                string path = base + (string(format) == "text" ? ".txt" : ".bin");
+                bool text = string(format) == "text";
+                timer.run([&](int) { ok = (text ? grid.saveGrid(path) : grid.saveSnapshot(path)) && ok; });
+                double megabytes = filesystem::exists(path) ? filesystem::file_size(path) / 1e6 : 0;
+                writeMeasurement(*out, first, kind->name, grid, string("save_") + format, timer, megabytes, "MB/s");
+                Graph loaded(1);
+                loaded.setVerbose(false);
+                timer.run([&](int) { ok = loaded.loadGrid(path) && ok; });
+                writeMeasurement(*out, first, kind->name, grid, string("load_") + format, timer, megabytes, "MB/s");
+                remove(path.c_str());
+            }
+            if (!ok) {
+                cout << "Error in file round trip under " << dir << "\n";
+                return 1;
+            }
+            if (!outFile.empty()) {
+                cout << kind->name << " " << n << ": " << grid.getNumLines() << " lines, "
+                     << (connected ? "connected" : "disconnected") << "\n";
+            }
+        }
+    }
+    *out << "\n]}\n";
+    return 0;
+}
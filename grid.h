@@ -0,0 +1,3999 @@
+// Grid model and cascade engine, shared by the simulator and the benchmark
+#ifndef GRID_H
+#define GRID_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <limits>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <random>
+#include <iomanip>
+#include <ctime>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <charconv>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <bitset>
+#ifndef GRID_METRICS
+#define GRID_METRICS 1 // Build with -DGRID_METRICS=0 to compile the counters and timers out
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GRID_X86_KERNELS
+#endif
+
+using namespace std;
+
+// The engine is templated on its numeric type (loads and capacities) and its
+// index type (node indices, line IDs and counts); the Basic* templates below
+// take them as Real and Index. Graph and the names used with it are the
+// double/int instantiation; the presets after BasicGraph trade precision or
+// range against memory. Indices are signed: -1 marks "none" throughout.
+
+// Structure to represent a transmission line; each line is stored once.
+// Its capacity lives in Graph::lineCapacity with the other hot arrays.
+template <typename Index>
+struct BasicLine {
+    Index from, to; // Endpoint nodes
+    double reactance = 1.0; // Series reactance (p.u.), used by the DC flow model
+
+    // Snapshots store lines with 32-bit indices whatever the engine's index type
+    template <typename Other>
+    operator BasicLine<Other>() const { return {static_cast<Other>(from), static_cast<Other>(to), reactance}; }
+};
+
+// Entry in the CSR adjacency: neighbouring node and the line leading to it
+template <typename Index>
+struct BasicAdjacent {
+    Index to;
+    Index line;
+
+    template <typename Other>
+    operator BasicAdjacent<Other>() const { return {static_cast<Other>(to), static_cast<Other>(line)}; }
+};
+
+using Line = BasicLine<int>;
+using Adjacent = BasicAdjacent<int>;
+
+// Allocator for the hot numeric arrays; cache-line aligned so the vector
+// kernels never split a load across lines at the start of an array
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr size_t alignment = 64;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(alignment))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, align_val_t(alignment)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = vector<T, AlignedAllocator<T>>;
+
+// Bit-packed status of nodes or lines, 64 per word; bits past size() stay zero
+class ActiveMask {
+private:
+    vector<uint64_t> bits;
+    size_t length = 0;
+
+public:
+    size_t size() const { return length; }
+    const uint64_t* words() const { return bits.data(); }
+
+    bool operator[](size_t i) const { return (bits[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i, bool on) {
+        uint64_t bit = uint64_t(1) << (i & 63);
+        if (on) bits[i >> 6] |= bit;
+        else bits[i >> 6] &= ~bit;
+    }
+
+    void assign(size_t n, bool on) {
+        length = n;
+        bits.assign((n + 63) / 64, on ? ~uint64_t(0) : 0);
+        if (on && (n & 63)) bits.back() = (uint64_t(1) << (n & 63)) - 1;
+    }
+
+    void reserve(size_t n) { bits.reserve((n + 63) / 64); }
+
+    void push_back(bool on) {
+        if ((length & 63) == 0) bits.push_back(0);
+        set(length++, on);
+    }
+
+    size_t countSet() const {
+        size_t total = 0;
+        for (uint64_t w : bits) total += bitset<64>(w).count();
+        return total;
+    }
+
+    // Convert from and to one byte per element, as snapshots store status
+    void assignBytes(const char* bytes, size_t n) {
+        assign(n, false);
+        for (size_t i = 0; i < n; i++) {
+            if (bytes[i]) set(i, true);
+        }
+    }
+    vector<char> toBytes() const {
+        vector<char> bytes(length);
+        for (size_t i = 0; i < length; i++) bytes[i] = (*this)[i];
+        return bytes;
+    }
+};
+
+// Vector kernels for the cascade's whole-grid passes. Each has a scalar
+// version and, on x86 with GCC or Clang, AVX2 and AVX-512 versions built with
+// target attributes; loadKernels() picks the widest one the CPU supports.
+// Results are bit-identical across versions: no operation is fused or reordered.
+// Loads are double or float; ratios are always computed and kept in double.
+template <typename Real, typename Index>
+struct BasicLoadKernels {
+    const char* name;
+    // loads[i] *= multipliers[i] (or uniform when multipliers is null) for each active i
+    void (*scale)(Real* loads, const Real* multipliers, Real uniform, const uint64_t* active, size_t n);
+    // out[i] = a[i] / b[i]
+    void (*ratio)(double* out, const Real* a, const Real* b, size_t n);
+    // Write each active i with loads[i] >= capacity[i] to out in ascending order; returns the count
+    size_t (*overloads)(const Real* loads, const Real* capacity, const uint64_t* active, size_t n, Index* out);
+};
+
+using LoadKernels = BasicLoadKernels<double, int>;
+
+inline bool activeBit(const uint64_t* active, size_t i) { return (active[i >> 6] >> (i & 63)) & 1; }
+
+template <typename Real>
+inline void scaleScalar(Real* loads, const Real* multipliers, Real uniform, const uint64_t* active, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (activeBit(active, i)) loads[i] *= multipliers ? multipliers[i] : uniform;
+    }
+}
+
+template <typename Real>
+inline void ratioScalar(double* out, const Real* a, const Real* b, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = static_cast<double>(a[i]) / b[i];
+}
+
+template <typename Real, typename Index>
+inline size_t overloadsScalar(const Real* loads, const Real* capacity, const uint64_t* active, size_t n, Index* out) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (activeBit(active, i) && loads[i] >= capacity[i]) out[count++] = static_cast<Index>(i);
+    }
+    return count;
+}
+
+#ifdef GRID_X86_KERNELS
+// Blocks of 4 doubles or 8 floats (AVX2), or 8 doubles or 16 floats (AVX-512),
+// start at multiples of the block size, so a block's status bits never
+// straddle two mask words
+
+__attribute__((target("avx2")))
+inline void scaleAvx2(double* loads, const double* multipliers, double uniform, const uint64_t* active, size_t n) {
+    const __m256i lane = _mm256_setr_epi64x(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        long long bits = (active[i >> 6] >> (i & 63)) & 0xF;
+        if (!bits) continue;
+        __m256d keep = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(bits), lane), lane));
+        __m256d m = multipliers ? _mm256_loadu_pd(multipliers + i) : _mm256_set1_pd(uniform);
+        __m256d l = _mm256_loadu_pd(loads + i);
+        _mm256_storeu_pd(loads + i, _mm256_blendv_pd(l, _mm256_mul_pd(l, m), keep));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i)) loads[i] *= multipliers ? multipliers[i] : uniform;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void scaleAvx2(float* loads, const float* multipliers, float uniform, const uint64_t* active, size_t n) {
+    const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int bits = static_cast<int>((active[i >> 6] >> (i & 63)) & 0xFF);
+        if (!bits) continue;
+        __m256 keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lane), lane));
+        __m256 m = multipliers ? _mm256_loadu_ps(multipliers + i) : _mm256_set1_ps(uniform);
+        __m256 l = _mm256_loadu_ps(loads + i);
+        _mm256_storeu_ps(loads + i, _mm256_blendv_ps(l, _mm256_mul_ps(l, m), keep));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i)) loads[i] *= multipliers ? multipliers[i] : uniform;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void ratioAvx2(double* out, const double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    for (; i < n; i++) out[i] = a[i] / b[i];
+}
+
+__attribute__((target("avx2")))
+inline void ratioAvx2(double* out, const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i))));
+    }
+    for (; i < n; i++) out[i] = static_cast<double>(a[i]) / b[i];
+}
+
+template <typename Index>
+__attribute__((target("avx2")))
+inline size_t overloadsAvx2(const double* loads, const double* capacity, const uint64_t* active, size_t n, Index* out) {
+    size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        unsigned bits = (active[i >> 6] >> (i & 63)) & 0xF;
+        if (!bits) continue;
+        unsigned hit = bits & _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(loads + i), _mm256_loadu_pd(capacity + i), _CMP_GE_OQ));
+        for (; hit; hit &= hit - 1) out[count++] = static_cast<Index>(i + __builtin_ctz(hit));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i) && loads[i] >= capacity[i]) out[count++] = static_cast<Index>(i);
+    }
+    return count;
+}
+
+template <typename Index>
+__attribute__((target("avx2")))
+inline size_t overloadsAvx2(const float* loads, const float* capacity, const uint64_t* active, size_t n, Index* out) {
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        unsigned bits = (active[i >> 6] >> (i & 63)) & 0xFF;
+        if (!bits) continue;
+        unsigned hit = bits & _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(loads + i), _mm256_loadu_ps(capacity + i), _CMP_GE_OQ));
+        for (; hit; hit &= hit - 1) out[count++] = static_cast<Index>(i + __builtin_ctz(hit));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i) && loads[i] >= capacity[i]) out[count++] = static_cast<Index>(i);
+    }
+    return count;
+}
+
+__attribute__((target("avx512f")))
+inline void scaleAvx512(double* loads, const double* multipliers, double uniform, const uint64_t* active, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 bits = static_cast<__mmask8>(active[i >> 6] >> (i & 63));
+        if (!bits) continue;
+        __m512d m = multipliers ? _mm512_loadu_pd(multipliers + i) : _mm512_set1_pd(uniform);
+        _mm512_mask_storeu_pd(loads + i, bits, _mm512_mul_pd(_mm512_loadu_pd(loads + i), m));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i)) loads[i] *= multipliers ? multipliers[i] : uniform;
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void scaleAvx512(float* loads, const float* multipliers, float uniform, const uint64_t* active, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 bits = static_cast<__mmask16>(active[i >> 6] >> (i & 63));
+        if (!bits) continue;
+        __m512 m = multipliers ? _mm512_loadu_ps(multipliers + i) : _mm512_set1_ps(uniform);
+        _mm512_mask_storeu_ps(loads + i, bits, _mm512_mul_ps(_mm512_loadu_ps(loads + i), m));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i)) loads[i] *= multipliers ? multipliers[i] : uniform;
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void ratioAvx512(double* out, const double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_div_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    for (; i < n; i++) out[i] = a[i] / b[i];
+}
+
+__attribute__((target("avx512f")))
+inline void ratioAvx512(double* out, const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // The zero-masked widening avoids GCC's uninitialized warning on the unmasked intrinsic
+        __m512d wa = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(a + i));
+        __m512d wb = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(b + i));
+        _mm512_storeu_pd(out + i, _mm512_div_pd(wa, wb));
+    }
+    for (; i < n; i++) out[i] = static_cast<double>(a[i]) / b[i];
+}
+
+template <typename Index>
+__attribute__((target("avx512f")))
+inline size_t overloadsAvx512(const double* loads, const double* capacity, const uint64_t* active, size_t n, Index* out) {
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 bits = static_cast<__mmask8>(active[i >> 6] >> (i & 63));
+        if (!bits) continue;
+        unsigned hit = _mm512_mask_cmp_pd_mask(bits, _mm512_loadu_pd(loads + i), _mm512_loadu_pd(capacity + i), _CMP_GE_OQ);
+        for (; hit; hit &= hit - 1) out[count++] = static_cast<Index>(i + __builtin_ctz(hit));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i) && loads[i] >= capacity[i]) out[count++] = static_cast<Index>(i);
+    }
+    return count;
+}
+
+template <typename Index>
+__attribute__((target("avx512f")))
+inline size_t overloadsAvx512(const float* loads, const float* capacity, const uint64_t* active, size_t n, Index* out) {
+    size_t count = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 bits = static_cast<__mmask16>(active[i >> 6] >> (i & 63));
+        if (!bits) continue;
+        unsigned hit = _mm512_mask_cmp_ps_mask(bits, _mm512_loadu_ps(loads + i), _mm512_loadu_ps(capacity + i), _CMP_GE_OQ);
+        for (; hit; hit &= hit - 1) out[count++] = static_cast<Index>(i + __builtin_ctz(hit));
+    }
+    for (; i < n; i++) {
+        if (activeBit(active, i) && loads[i] >= capacity[i]) out[count++] = static_cast<Index>(i);
+    }
+    return count;
+}
+#endif
+
+// Kernels for this CPU, chosen once per instantiation. GRID_KERNELS=scalar or
+// avx2 caps the choice, to compare results or timings against the wider versions.
+template <typename Real = double, typename Index = int>
+inline const BasicLoadKernels<Real, Index>& loadKernels() {
+    static_assert(is_same<Real, double>::value || is_same<Real, float>::value, "loads are double or float");
+    using Kernels = BasicLoadKernels<Real, Index>;
+    static const Kernels chosen = [] {
+        const char* cap = getenv("GRID_KERNELS");
+        string limit = cap ? cap : "";
+#ifdef GRID_X86_KERNELS
+        __builtin_cpu_init();
+        if (limit != "scalar" && limit != "avx2" && __builtin_cpu_supports("avx512f")) {
+            return Kernels{"avx512", scaleAvx512, ratioAvx512, overloadsAvx512};
+        }
+        if (limit != "scalar" && __builtin_cpu_supports("avx2")) {
+            return Kernels{"avx2", scaleAvx2, ratioAvx2, overloadsAvx2};
+        }
+#endif
+        return Kernels{"scalar", scaleScalar, ratioScalar, overloadsScalar};
+    }();
+    return chosen;
+}
+
+// Union-Find for connectivity
+template <typename Index>
+class BasicUnionFind {
+private:
+    vector<Index> parent, rank, size;
+public:
+    BasicUnionFind(Index n = 0) { reset(n); }
+    // Split back into n singletons, keeping the arrays' storage
+    void reset(Index n) {
+        parent.resize(n);
+        rank.assign(n, 0);
+        size.assign(n, 1);
+        for (Index i = 0; i < n; i++) parent[i] = i;
+    }
+    Index find(Index x) {
+        if (x < 0 || x >= static_cast<Index>(parent.size())) return -1;
+        if (parent[x] != x) parent[x] = find(parent[x]);
+        return parent[x];
+    }
+    Index find(Index x) const {
+        if (x < 0 || x >= static_cast<Index>(parent.size())) return -1;
+        if (parent[x] == x) return x;
+        return find(parent[x]);
+    }
+    // Merge the sets of x and y; returns false if they were already joined
+    bool unite(Index x, Index y) {
+        Index px = find(x), py = find(y);
+        if (px == py || px == -1 || py == -1) return false;
+        if (rank[px] < rank[py]) swap(px, py);
+        parent[py] = px;
+        size[px] += size[py];
+        if (rank[px] == rank[py]) rank[px]++;
+        return true;
+    }
+    // Number of elements in the set containing x
+    Index setSize(Index x) {
+        return size[find(x)];
+    }
+    bool connected(Index x, Index y) const {
+        return find(x) == find(y);
+    }
+};
+
+using UnionFind = BasicUnionFind<int>;
+
+// Binary min-heap over element IDs with in-place priority updates
+template <typename Index>
+class BasicIndexedMinHeap {
+private:
+    vector<Index> heap; // Element IDs in heap order
+    vector<Index> pos; // Position of each element in heap, or -1 if absent
+    vector<double> priority;
+
+    bool before(Index a, Index b) const {
+        return priority[a] < priority[b] || (priority[a] == priority[b] && a < b);
+    }
+    void place(Index i, Index id) {
+        heap[i] = id;
+        pos[id] = i;
+    }
+    void siftUp(Index i) {
+        Index id = heap[i];
+        while (i > 0 && before(id, heap[(i - 1) / 2])) {
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, id);
+    }
+    void siftDown(Index i) {
+        Index id = heap[i], n = static_cast<Index>(heap.size());
+        while (2 * i + 1 < n) {
+            Index c = 2 * i + 1;
+            if (c + 1 < n && before(heap[c + 1], heap[c])) c++;
+            if (!before(heap[c], id)) break;
+            place(i, heap[c]);
+            i = c;
+        }
+        place(i, id);
+    }
+public:
+    BasicIndexedMinHeap(Index n = 0) : pos(n, -1), priority(n) {}
+    // Empty the heap for IDs below n; only the IDs still queued are cleared
+    void reset(Index n) {
+        if (pos.size() != static_cast<size_t>(n)) {
+            pos.assign(n, -1);
+            priority.resize(n);
+        } else {
+            for (Index id : heap) pos[id] = -1;
+        }
+        heap.clear();
+    }
+    bool empty() const { return heap.empty(); }
+    bool contains(Index id) const { return pos[id] != -1; }
+    Index top() const { return heap[0]; }
+    // Insert id or move it to its new priority
+    void push(Index id, double p) {
+        if (pos[id] == -1) {
+            priority[id] = p;
+            heap.push_back(id);
+            siftUp(static_cast<Index>(heap.size()) - 1);
+        } else if (p < priority[id]) {
+            priority[id] = p;
+            siftUp(pos[id]);
+        } else {
+            priority[id] = p;
+            siftDown(pos[id]);
+        }
+    }
+    void remove(Index id) {
+        Index i = pos[id];
+        if (i == -1) return;
+        pos[id] = -1;
+        Index last = heap.back();
+        heap.pop_back();
+        if (last == id) return;
+        place(i, last);
+        siftUp(i);
+        siftDown(pos[last]);
+    }
+    Index pop() {
+        Index id = heap[0];
+        remove(id);
+        return id;
+    }
+};
+
+using IndexedMinHeap = BasicIndexedMinHeap<int>;
+
+// Fixed set of worker threads running index ranges with work stealing: each
+// worker starts with an equal slice and, when it runs dry, steals half of the
+// largest remaining slice. The calling thread takes part as worker 0.
+class WorkStealingPool {
+private:
+    struct Slice {
+        mutex lock;
+        size_t begin = 0, end = 0;
+    };
+    vector<thread> threads;
+    vector<unique_ptr<Slice>> slices;
+    mutex jobLock;
+    condition_variable jobReady, jobDone;
+    const function<void(unsigned, size_t)>* job = nullptr;
+    atomic<bool> running{false}; // Set while the workers run some caller's job
+    size_t grain = 1;
+    unsigned generation = 0, busy = 0;
+    bool stopping = false;
+
+    // Claim the next chunk for worker w, stealing if its own slice is empty
+    bool claim(unsigned w, size_t& begin, size_t& end) {
+        while (true) {
+            {
+                lock_guard<mutex> guard(slices[w]->lock);
+                Slice& own = *slices[w];
+                if (own.begin < own.end) {
+                    begin = own.begin;
+                    end = min(own.end, own.begin + grain);
+                    own.begin = end;
+                    return true;
+                }
+            }
+            unsigned victim = w;
+            size_t most = 0;
+            for (unsigned v = 0; v < slices.size(); v++) {
+                lock_guard<mutex> guard(slices[v]->lock);
+                if (slices[v]->end - slices[v]->begin > most) {
+                    most = slices[v]->end - slices[v]->begin;
+                    victim = v;
+                }
+            }
+            if (most == 0) return false;
+            size_t stolenBegin, stolenEnd;
+            {
+                lock_guard<mutex> guard(slices[victim]->lock);
+                Slice& other = *slices[victim];
+                if (other.begin >= other.end) continue; // Lost the race, look again
+                stolenEnd = other.end;
+                stolenBegin = other.end - (other.end - other.begin + 1) / 2;
+                other.end = stolenBegin;
+            }
+            lock_guard<mutex> guard(slices[w]->lock);
+            slices[w]->begin = stolenBegin;
+            slices[w]->end = stolenEnd;
+        }
+    }
+
+    void runJob(unsigned w) {
+        size_t begin, end;
+        while (claim(w, begin, end)) {
+            for (size_t i = begin; i < end; i++) (*job)(w, i);
+        }
+    }
+
+    void workerLoop(unsigned w) {
+        unsigned seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lk(jobLock);
+                jobReady.wait(lk, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runJob(w);
+            lock_guard<mutex> lk(jobLock);
+            if (--busy == 0) jobDone.notify_all();
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned workers = thread::hardware_concurrency()) {
+        workers = max(1u, workers);
+        for (unsigned w = 0; w < workers; w++) slices.push_back(make_unique<Slice>());
+        for (unsigned w = 1; w < workers; w++) threads.emplace_back(&WorkStealingPool::workerLoop, this, w);
+    }
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lk(jobLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (thread& t : threads) t.join();
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(slices.size()); }
+
+    // Call fn(worker, i) for every i in [0, count) and wait for all of them.
+    // A call made while another runs, from a second thread or from inside fn,
+    // runs on its calling thread alone as worker 0, so any caller may share a pool.
+    void parallelFor(size_t count, const function<void(unsigned, size_t)>& fn) {
+        if (count == 0) return;
+        bool idle = false;
+        if (!running.compare_exchange_strong(idle, true, memory_order_acquire)) {
+            for (size_t i = 0; i < count; i++) fn(0, i);
+            return;
+        }
+        unsigned n = size();
+        for (unsigned w = 0; w < n; w++) {
+            lock_guard<mutex> guard(slices[w]->lock);
+            slices[w]->begin = count * w / n;
+            slices[w]->end = count * (w + 1) / n;
+        }
+        grain = max<size_t>(1, count / (n * 64));
+        {
+            lock_guard<mutex> lk(jobLock);
+            job = &fn;
+            busy = n - 1;
+            generation++;
+        }
+        jobReady.notify_all();
+        runJob(0);
+        unique_lock<mutex> lk(jobLock);
+        jobDone.wait(lk, [&] { return busy == 0; });
+        job = nullptr;
+        running.store(false, memory_order_release);
+    }
+};
+
+// Counter-based random generator (Philox4x32-10). Each (seed, stream) pair
+// is an independent sequence, so parallel trials need no shared state.
+class Philox4x32 {
+private:
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t block[4];
+    int used = 4;
+
+    static void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+        uint64_t product = static_cast<uint64_t>(a) * b;
+        hi = static_cast<uint32_t>(product >> 32);
+        lo = static_cast<uint32_t>(product);
+    }
+
+    void generate() {
+        uint32_t x[4] = {counter[0], counter[1], counter[2], counter[3]};
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            uint32_t hi0, lo0, hi1, lo1;
+            mulhilo(0xD2511F53u, x[0], hi0, lo0);
+            mulhilo(0xCD9E8D57u, x[2], hi1, lo1);
+            x[0] = hi1 ^ x[1] ^ k0;
+            x[1] = lo1;
+            x[2] = hi0 ^ x[3] ^ k1;
+            x[3] = lo0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        for (int i = 0; i < 4; i++) block[i] = x[i];
+        if (++counter[0] == 0) ++counter[1];
+        used = 0;
+    }
+
+public:
+    Philox4x32(uint64_t seed, uint64_t stream) {
+        key[0] = static_cast<uint32_t>(seed);
+        key[1] = static_cast<uint32_t>(seed >> 32);
+        counter[0] = counter[1] = 0;
+        counter[2] = static_cast<uint32_t>(stream);
+        counter[3] = static_cast<uint32_t>(stream >> 32);
+    }
+
+    uint32_t next() {
+        if (used == 4) generate();
+        return block[used++];
+    }
+
+    // Uniform double in [0, 1) with 53 random bits
+    double uniform() {
+        uint64_t bits = (static_cast<uint64_t>(next()) << 21) ^ (next() >> 11);
+        return static_cast<double>(bits) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// Shared pool sized to the machine, defined after Graph
+WorkStealingPool& defaultPool();
+
+// Elements forced out of service before a cascade (N-k contingency)
+template <typename Index>
+struct BasicContingency {
+    vector<Index> nodes;
+    vector<Index> lines; // Line IDs
+};
+
+template <typename Index>
+struct BasicCascadeResult;
+
+// Parameters of one cascade run
+template <typename Index>
+struct BasicCascadeOptions {
+    double loadIncreasePercent = 0.0;
+    bool randomLoad = false;
+    uint64_t seed = 0; // Random stream key
+    uint64_t trial = 0; // Stream index, so trial t is reproducible on its own
+    bool dcFlow = false; // Move failed flows by DC power flow instead of to adjacent lines
+    // Fail every element overloaded at the start of a round together, instead
+    // of one element at a time, most overloaded last
+    bool rounds = false;
+    // A failed node trips its lines and passes its demand to its neighbours,
+    // and each island left at the end is balanced on its own generation
+    bool balanceIslands = false;
+    // Replay the failures into CascadeResult::timeline; runs that only read
+    // the final state, such as Monte Carlo trials, turn this off
+    bool islandTimeline = true;
+    // Spreads the redistributions of large rounds and the balancing of many
+    // islands; must be null when the cascade itself runs inside a pool task
+    WorkStealingPool* pool = nullptr;
+    BasicContingency<Index> outages;
+    // Checked after each overload failure (each round with rounds); the cascade stops early once it returns true
+    function<bool(const BasicCascadeResult<Index>&)> stopWhen;
+};
+
+// Per-element counts gathered over Monte Carlo trials
+struct ElementStats {
+    uint64_t failures = 0; // Trials in which the element failed
+    uint64_t cascadeSizeSum = 0; // Total cascade size over those trials
+    // Trials in which it ended in service but cut off from the main island;
+    // for a line, both ends in the same smaller island
+    uint64_t islanded = 0;
+
+    ElementStats& operator+=(const ElementStats& other) {
+        failures += other.failures;
+        cascadeSizeSum += other.cascadeSizeSum;
+        islanded += other.islanded;
+        return *this;
+    }
+};
+
+// Aggregate outcome of a Monte Carlo run
+struct MonteCarloSummary {
+    uint64_t trials = 0;
+    uint64_t totalFailures = 0; // Sum of cascade sizes
+    uint64_t islandedTrials = 0; // Trials ending with more than one island
+    uint64_t sheddingTrials = 0; // Trials in which a balanced island shed load
+    uint64_t blackoutTrials = 0; // Trials in which a balanced island blacked out
+    vector<ElementStats> nodes;
+    vector<ElementStats> lines; // Indexed by line ID
+};
+
+// Load passed from a failed line to one line at its end node
+template <typename Index>
+struct BasicLoadShare {
+    Index node;
+    Index line; // -1 if the node had no spare capacity
+    double load;
+};
+
+// A single failure during a cascade; exactly one of node and line is >= 0
+template <typename Index>
+struct BasicFailureEvent {
+    Index node;
+    Index line;
+    double load; // Load at the time of failure in MW
+    double capacity; // Capacity in MW
+    bool forced; // Taken out by the contingency rather than by an overload
+};
+
+// Connected components as flat arrays: the members of component c are
+// members[offsets[c] .. offsets[c + 1]) in ascending node order, and
+// components are numbered by their lowest node index
+template <typename Index>
+struct BasicComponentLabels {
+    vector<Index> label; // Component of each node, -1 if the node is out of service
+    vector<Index> offsets;
+    vector<Index> members;
+
+    size_t count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    Index size(size_t c) const { return offsets[c + 1] - offsets[c]; }
+};
+
+// Generation against demand in one island at the end of a cascade
+struct IslandBalance {
+    double generation = 0; // MW available in the island
+    double demand = 0; // MW of load before shedding
+    double shed = 0; // MW shed to match generation
+    int stages = 0; // Under-frequency shedding stages tripped
+    bool blackout = false; // No generation, or a deficit beyond the last stage
+};
+
+// Connectivity right after one failure of a cascade
+template <typename Index>
+struct BasicIslandStep {
+    Index islands; // Number of islands
+    Index largest; // Nodes in the largest island
+    vector<Index> pieces; // Sizes of the islands this failure split apart, largest first; empty if it split nothing
+};
+
+// Structured outcome of one cascade run
+template <typename Index>
+struct BasicCascadeResult {
+    vector<BasicFailureEvent<Index>> events; // Failures in order
+    vector<BasicIslandStep<Index>> timeline; // Connectivity after each event
+    Index initialIslands = 0; // Islands before the first failure
+    vector<bool> nodeActive; // Final node status
+    vector<bool> lineActive; // Final line status, indexed by line ID
+    BasicComponentLabels<Index> islands; // Connected components of the final grid
+    vector<double> nodePeakLoading; // Highest load / capacity seen per node
+    vector<double> linePeakLoading; // Highest load / capacity seen per line
+    int rounds = 0; // Rounds run by a round-based cascade; 0 for a serial one
+    // Filled in when islands are balanced
+    vector<IslandBalance> balance; // Per island of islands
+    double transferredDemand = 0; // MW of failed nodes' demand moved to their neighbours
+    double droppedDemand = 0; // MW of failed nodes' demand no neighbour could take
+};
+
+// Smallest load increases found by a margin search; -1 if not reached within the limit
+struct MarginResult {
+    double firstFailure = -1; // Some element fails
+    double islanding = -1; // The grid splits into more islands than it had
+    double nodeLoss = -1; // The given share of nodes fails or is cut off from the largest island
+    int cascades = 0; // Cascades run by the search
+};
+
+// A line whose outage disconnects the grid or overloads its neighbours
+template <typename Index>
+struct BasicCriticalLine {
+    Index line;
+    bool disconnects; // Otherwise the outage causes overloads
+};
+
+// Result of the critical component analysis
+template <typename Index>
+struct BasicCriticalReport {
+    vector<Index> nodes; // Nodes whose failure disconnects the grid
+    vector<BasicCriticalLine<Index>> lines;
+};
+
+// Articulation points and bridges of the active grid
+template <typename Index>
+struct BasicCutAnalysis {
+    Index components = 0; // Islands among active nodes
+    vector<Index> pieces; // Islands a node's own island splits into if it fails
+    vector<bool> bridge; // Lines whose outage splits their island
+};
+
+// Optional listener for cascade progress; every hook defaults to a no-op
+template <typename Index>
+class BasicCascadeObserver {
+public:
+    virtual ~BasicCascadeObserver() = default;
+    virtual void onStart(double /*loadIncreasePercent*/, bool /*randomLoad*/) {}
+    virtual void onNodeLoadIncrease(Index /*node*/, double /*oldLoad*/, double /*newLoad*/, double /*factor*/) {}
+    virtual void onLineLoadIncrease(Index /*line*/, double /*oldLoad*/, double /*newLoad*/, double /*factor*/) {}
+    virtual void onOverloadCheck(size_t /*nodes*/, size_t /*lines*/, bool /*initial*/) {}
+    virtual void onFailure(const BasicFailureEvent<Index>& /*event*/) {}
+    virtual void onRedistribute(Index /*from*/, Index /*line*/, double /*amount*/) {}
+    virtual void onNoSpareCapacity(Index /*node*/) {}
+    // A failed node's demand moved to node to, or dropped if to is -1; the
+    // failed node's own load is 0 afterwards
+    virtual void onDemandTransfer(Index /*from*/, Index /*to*/, double /*amount*/) {}
+    // The island containing node shed load, keeping this share of the loads of its nodes and lines
+    virtual void onShed(Index /*node*/, double /*keep*/) {}
+    virtual void onFinish(const BasicCascadeResult<Index>& /*result*/) {}
+};
+
+using Contingency = BasicContingency<int>;
+using CascadeOptions = BasicCascadeOptions<int>;
+using LoadShare = BasicLoadShare<int>;
+using FailureEvent = BasicFailureEvent<int>;
+using ComponentLabels = BasicComponentLabels<int>;
+using IslandStep = BasicIslandStep<int>;
+using CascadeResult = BasicCascadeResult<int>;
+using CriticalLine = BasicCriticalLine<int>;
+using CriticalReport = BasicCriticalReport<int>;
+using CutAnalysis = BasicCutAnalysis<int>;
+using CascadeObserver = BasicCascadeObserver<int>;
+
+// Shortest text that reads back as exactly v
+inline string formatNumber(double v) {
+    char buf[32];
+    return string(buf, to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+#if GRID_METRICS
+// Hot-path counters and phase timers. Each thread updates its own block with
+// relaxed atomics, so the owner never contends; blocks are linked into a
+// lock-free list on first use and summed when the metrics are exported.
+// Phases are timed with the CPU timestamp counter where there is one, and
+// phases as short as a redistribution only on every 16th call, with the total
+// scaled up from the sample: a timer read costs as much as a few line updates.
+enum Metric : int {
+    CascadeRuns, CascadeSteps, OverloadScans, HeapPushes, HeapPops, Redistributions,
+    ConnectivityQueries, IslandsBalanced, LoadSaves, Checkpoints, Rollbacks, BytesWritten, MetricCount
+};
+enum Phase : int {
+    CascadePhase, OverloadScanPhase, RedistributionPhase, ConnectivityPhase, BalancePhase, RollbackPhase, PhaseCount
+};
+
+struct MetricsBlock {
+    atomic<uint64_t> counts[MetricCount] = {};
+    atomic<uint64_t> phaseTicks[PhaseCount] = {};
+    atomic<uint64_t> phaseCalls[PhaseCount] = {};
+    atomic<uint64_t> phaseTimed[PhaseCount] = {}; // Calls included in phaseTicks
+    MetricsBlock* next = nullptr;
+};
+
+struct MetricsTotals {
+    uint64_t counts[MetricCount] = {};
+    double phaseSeconds[PhaseCount] = {};
+    uint64_t phaseCalls[PhaseCount] = {};
+    int threads = 0;
+};
+
+class Metrics {
+private:
+    static atomic<MetricsBlock*>& head() {
+        static atomic<MetricsBlock*> first{nullptr};
+        return first;
+    }
+
+    // Blocks are never freed, so counts from finished threads are kept
+    static MetricsBlock* registerBlock() {
+        MetricsBlock* block = new MetricsBlock;
+        block->next = head().load(memory_order_relaxed);
+        while (!head().compare_exchange_weak(block->next, block, memory_order_release, memory_order_relaxed)) {}
+        return block;
+    }
+
+    static void bump(atomic<uint64_t>& c, uint64_t n) { c.store(c.load(memory_order_relaxed) + n, memory_order_relaxed); }
+
+    // Tick count and time at first use, to convert ticks to seconds
+    struct Origin {
+        uint64_t tick = ticks();
+        chrono::steady_clock::time_point time = chrono::steady_clock::now();
+    };
+    static const Origin& origin() {
+        static const Origin first;
+        return first;
+    }
+
+    static double secondsPerTick() {
+#ifdef GRID_X86_KERNELS
+        const Origin& o = origin();
+        auto elapsed = chrono::steady_clock::now() - o.time;
+        if (elapsed < chrono::milliseconds(10)) this_thread::sleep_for(chrono::milliseconds(10) - elapsed);
+        uint64_t tick = ticks();
+        return chrono::duration<double>(chrono::steady_clock::now() - o.time).count() / (tick - o.tick);
+#else
+        return 1e-9;
+#endif
+    }
+
+public:
+    static uint64_t ticks() {
+#ifdef GRID_X86_KERNELS
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static MetricsBlock& local() {
+        thread_local MetricsBlock* block = (origin(), registerBlock());
+        return *block;
+    }
+
+    static void add(Metric m, uint64_t n) { bump(local().counts[m], n); }
+
+    static void addPhase(Phase p, uint64_t elapsed, bool timed) {
+        MetricsBlock& block = local();
+        bump(block.phaseCalls[p], 1);
+        if (!timed) return;
+        bump(block.phaseTicks[p], elapsed);
+        bump(block.phaseTimed[p], 1);
+    }
+
+    // Whether the next call of a sampled phase is timed
+    static bool sampleNext(Phase p) { return (local().phaseCalls[p].load(memory_order_relaxed) & 15) == 0; }
+
+    static MetricsTotals total() {
+        MetricsTotals t;
+        double scale = secondsPerTick();
+        for (MetricsBlock* b = head().load(memory_order_acquire); b; b = b->next) {
+            for (int m = 0; m < MetricCount; m++) t.counts[m] += b->counts[m].load(memory_order_relaxed);
+            for (int p = 0; p < PhaseCount; p++) {
+                uint64_t calls = b->phaseCalls[p].load(memory_order_relaxed);
+                uint64_t timed = b->phaseTimed[p].load(memory_order_relaxed);
+                if (timed) t.phaseSeconds[p] += b->phaseTicks[p].load(memory_order_relaxed) * scale * calls / timed;
+                t.phaseCalls[p] += calls;
+            }
+            t.threads++;
+        }
+        return t;
+    }
+
+    static const char* name(Metric m) {
+        static const char* names[MetricCount] = {
+            "cascade_runs", "cascade_steps", "overload_scans", "heap_pushes", "heap_pops", "redistributions",
+            "connectivity_queries", "islands_balanced", "load_saves", "checkpoints", "rollbacks", "bytes_written"};
+        return names[m];
+    }
+
+    static const char* help(Metric m) {
+        static const char* texts[MetricCount] = {
+            "Cascades run", "Failures processed by cascades", "Full overload scans", "Overloaded elements queued",
+            "Overloaded elements dequeued, failed or relieved", "Failed line flows redistributed",
+            "Connected component labelings", "Islands balanced against their generation", "Whole load arrays journaled", "State checkpoints opened",
+            "State checkpoints rolled back", "Bytes of results, traces and grid files written"};
+        return texts[m];
+    }
+
+    static const char* name(Phase p) {
+        static const char* names[PhaseCount] = {"cascade", "overload_scan", "redistribution", "connectivity", "balance", "rollback"};
+        return names[p];
+    }
+};
+
+// Adds the time from construction to destruction to a phase
+class ScopedPhase {
+private:
+    Phase phase;
+    bool timed;
+    uint64_t start;
+
+public:
+    ScopedPhase(Phase p, bool time) : phase(p), timed(time), start(time ? Metrics::ticks() : 0) {}
+    ~ScopedPhase() { Metrics::addPhase(phase, timed ? Metrics::ticks() - start : 0, timed); }
+};
+
+// Write the totals as one JSON object
+inline void writeMetricsJson(ostream& out, const MetricsTotals& t) {
+    out << "{\"threads\":" << t.threads << ",\"counters\":{";
+    for (int m = 0; m < MetricCount; m++) {
+        out << (m ? ",\"" : "\"") << Metrics::name(static_cast<Metric>(m)) << "\":" << t.counts[m];
+    }
+    out << "},\"phases\":{";
+    for (int p = 0; p < PhaseCount; p++) {
+        out << (p ? ",\"" : "\"") << Metrics::name(static_cast<Phase>(p)) << "\":{\"calls\":" << t.phaseCalls[p]
+            << ",\"seconds\":" << formatNumber(t.phaseSeconds[p]) << "}";
+    }
+    out << "}}\n";
+}
+
+// Write the totals in the Prometheus text exposition format
+inline void writeMetricsPrometheus(ostream& out, const MetricsTotals& t) {
+    for (int m = 0; m < MetricCount; m++) {
+        string name = string("grid_") + Metrics::name(static_cast<Metric>(m)) + "_total";
+        out << "# HELP " << name << " " << Metrics::help(static_cast<Metric>(m)) << "\n# TYPE " << name << " counter\n"
+            << name << " " << t.counts[m] << "\n";
+    }
+    out << "# HELP grid_phase_seconds_total Time spent in each instrumented phase, summed over threads\n"
+        << "# TYPE grid_phase_seconds_total counter\n";
+    for (int p = 0; p < PhaseCount; p++) {
+        out << "grid_phase_seconds_total{phase=\"" << Metrics::name(static_cast<Phase>(p)) << "\"} "
+            << formatNumber(t.phaseSeconds[p]) << "\n";
+    }
+    out << "# HELP grid_phase_calls_total Calls of each instrumented phase\n# TYPE grid_phase_calls_total counter\n";
+    for (int p = 0; p < PhaseCount; p++) {
+        out << "grid_phase_calls_total{phase=\"" << Metrics::name(static_cast<Phase>(p)) << "\"} " << t.phaseCalls[p] << "\n";
+    }
+    out << "# HELP grid_threads Threads that recorded metrics\n# TYPE grid_threads gauge\ngrid_threads " << t.threads << "\n";
+}
+
+#define GRID_COUNT(metric, n) Metrics::add(metric, n)
+#define GRID_PHASE_NAME(line) gridPhase##line
+#define GRID_PHASE_AT(phase, line, timed) ScopedPhase GRID_PHASE_NAME(line)(phase, timed)
+#define GRID_TIME(phase) GRID_PHASE_AT(phase, __LINE__, true)
+#define GRID_TIME_SAMPLED(phase) GRID_PHASE_AT(phase, __LINE__, Metrics::sampleNext(phase))
+#else
+#define GRID_COUNT(metric, n) ((void)0)
+#define GRID_TIME(phase) ((void)0)
+#define GRID_TIME_SAMPLED(phase) ((void)0)
+#endif
+
+// Operating state of the grid by node index and line ID. The Graph owns the
+// base state; what-if workers take private copies over the shared topology.
+// While a checkpoint is open every change made through the setters is
+// journaled, so rollback costs O(changes) rather than a full copy.
+template <typename Real, typename Index>
+struct BasicGridState {
+    ActiveMask nodeActive; // Is the node operational?
+    AlignedVector<Real> nodeLoads; // Current power demand in MW
+    ActiveMask lineActive; // Is the line operational?
+    AlignedVector<Real> lineLoads; // Current load in MW
+
+    enum Field : int { NodeActive, NodeLoad, LineActive, LineLoad, AllLoads };
+    struct Change {
+        Field field;
+        Index index; // Element, or the savedLoads slot for AllLoads
+        double old;
+    };
+    vector<Change> trail; // Undo journal, oldest first
+    // Node and line loads per AllLoads entry. Slots from savedCount on are
+    // spares left by rollbacks, reused so a repeated save does not allocate.
+    vector<pair<AlignedVector<Real>, AlignedVector<Real>>> savedLoads;
+    size_t savedCount = 0;
+    vector<size_t> marks; // Trail length at each open checkpoint
+    vector<uint32_t> epochs; // Id of each open checkpoint
+    uint32_t lastEpoch = 0;
+    // Checkpoint id under which each line load was last journaled; a DC flow
+    // update rewrites every load, so only the first write per checkpoint is kept
+    vector<uint32_t> lineLoadEpoch;
+
+    void setNodeActive(Index i, bool active) {
+        if (!marks.empty()) trail.push_back({NodeActive, i, static_cast<double>(nodeActive[i])});
+        nodeActive.set(i, active);
+    }
+    void setNodeLoad(Index i, double load) {
+        if (!marks.empty()) trail.push_back({NodeLoad, i, nodeLoads[i]});
+        nodeLoads[i] = load;
+    }
+    void setLineActive(Index id, bool active) {
+        if (!marks.empty()) trail.push_back({LineActive, id, static_cast<double>(lineActive[id])});
+        lineActive.set(id, active);
+    }
+    void setLineLoad(Index id, double load) {
+        if (!marks.empty()) {
+            if (lineLoadEpoch.size() != lineLoads.size()) lineLoadEpoch.assign(lineLoads.size(), 0);
+            if (lineLoadEpoch[id] != epochs.back()) {
+                lineLoadEpoch[id] = epochs.back();
+                trail.push_back({LineLoad, id, lineLoads[id]});
+            }
+        }
+        lineLoads[id] = load;
+    }
+
+    // Journal both load arrays whole ahead of a bulk update that writes them
+    // directly; later line load writes in this checkpoint are covered too
+    void saveLoads() {
+        if (marks.empty()) return;
+        GRID_COUNT(LoadSaves, 1);
+        trail.push_back({AllLoads, static_cast<Index>(savedCount), 0.0});
+        if (savedCount == savedLoads.size()) savedLoads.emplace_back();
+        savedLoads[savedCount].first.assign(nodeLoads.begin(), nodeLoads.end());
+        savedLoads[savedCount].second.assign(lineLoads.begin(), lineLoads.end());
+        savedCount++;
+        lineLoadEpoch.assign(lineLoads.size(), epochs.back());
+    }
+
+    // Open a checkpoint; checkpoints nest
+    void checkpoint() {
+        GRID_COUNT(Checkpoints, 1);
+        marks.push_back(trail.size());
+        epochs.push_back(++lastEpoch);
+    }
+
+    // Undo every change since the innermost checkpoint and close it
+    void rollback() {
+        GRID_TIME(RollbackPhase);
+        GRID_COUNT(Rollbacks, 1);
+        size_t mark = marks.back();
+        marks.pop_back();
+        epochs.pop_back();
+        while (trail.size() > mark) {
+            const Change& c = trail.back();
+            switch (c.field) {
+                case NodeActive: nodeActive.set(c.index, c.old != 0); break;
+                case NodeLoad: nodeLoads[c.index] = c.old; break;
+                case LineActive: lineActive.set(c.index, c.old != 0); break;
+                case LineLoad: lineLoads[c.index] = c.old; break;
+                case AllLoads:
+                    savedCount--;
+                    nodeLoads.swap(savedLoads[savedCount].first);
+                    lineLoads.swap(savedLoads[savedCount].second);
+                    break;
+            }
+            trail.pop_back();
+        }
+    }
+
+    // Keep the changes since the innermost checkpoint; an enclosing
+    // checkpoint can still roll them back
+    void commit() {
+        marks.pop_back();
+        epochs.pop_back();
+        if (marks.empty()) {
+            trail.clear();
+            savedCount = 0;
+        }
+    }
+};
+
+// Per-worker scratch for line outage screening
+template <typename Real, typename Index>
+struct BasicContingencyScratch {
+    BasicGridState<Real, Index> state; // Private copy of the base state
+    vector<Index> touched;
+};
+
+using GridState = BasicGridState<double, int>;
+using ContingencyScratch = BasicContingencyScratch<double, int>;
+
+// Binary grid snapshot. The header is followed by 8-byte aligned sections in
+// native byte order; byteOrder lets a reader reject files from the other order.
+struct SnapshotHeader {
+    char magic[8]; // "EGRIDSNP"
+    uint32_t version;
+    uint32_t byteOrder; // 0x01020304 as written by the producer
+    uint64_t numNodes;
+    uint64_t numLines;
+    uint64_t nameBytes; // Size of the interned name table
+    uint64_t fileSize;
+    uint64_t checksum; // Over every byte after the header
+};
+
+// A node name as a slice of the interned name table
+struct NameRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(Line) == 16 && sizeof(Adjacent) == 8 && sizeof(NameRef) == 8,
+              "snapshot sections are raw copies of these records");
+
+const char snapshotMagic[8] = {'E', 'G', 'R', 'I', 'D', 'S', 'N', 'P'};
+// 2: lines carry a reactance; 3: line capacities in their own section; 4: node generation;
+// 5: self-supplied nodes store -1 as their generation
+const uint32_t snapshotVersion = 5;
+const uint32_t snapshotByteOrder = 0x01020304;
+
+// Byte offsets of the snapshot sections, derived from the element counts
+struct SnapshotLayout {
+    uint64_t nodeCapacity, nodeLoad, nodeGeneration, nodeActive, names;
+    uint64_t lines, lineCapacity, lineLoad, lineActive;
+    uint64_t rowStart, adjacency, nameTable, end;
+
+    SnapshotLayout(uint64_t n, uint64_t m, uint64_t nameBytes) {
+        uint64_t at = sizeof(SnapshotHeader);
+        auto section = [&](uint64_t bytes) {
+            uint64_t start = (at + 7) & ~uint64_t(7);
+            at = start + bytes;
+            return start;
+        };
+        nodeCapacity = section(n * sizeof(double));
+        nodeLoad = section(n * sizeof(double));
+        nodeGeneration = section(n * sizeof(double));
+        nodeActive = section(n);
+        names = section(n * sizeof(NameRef));
+        lines = section(m * sizeof(Line));
+        lineCapacity = section(m * sizeof(double));
+        lineLoad = section(m * sizeof(double));
+        lineActive = section(m);
+        rowStart = section((n + 1) * sizeof(int));
+        adjacency = section(2 * m * sizeof(Adjacent));
+        nameTable = section(nameBytes);
+        end = section(0);
+    }
+};
+
+// 64-bit FNV-1a over whole 8-byte words; the payload is always word padded
+inline uint64_t snapshotChecksum(const char* data, size_t bytes) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Read-only view of a whole file: memory mapped on POSIX, read into a buffer elsewhere
+class MappedFile {
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    vector<char> buffer;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+#ifndef _WIN32
+        if (base) munmap(const_cast<char*>(base), length);
+#endif
+    }
+
+    bool open(const string& filename, ostream& messages = cout) {
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            messages << "Error opening file: " << filename << "\n";
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            messages << "Error reading file: " << filename << "\n";
+            ::close(fd);
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            messages << "Error mapping file: " << filename << "\n";
+            length = 0;
+            return false;
+        }
+        base = static_cast<const char*>(mapping);
+#else
+        ifstream in(filename, ios::binary);
+        if (!in) {
+            messages << "Error opening file: " << filename << "\n";
+            return false;
+        }
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        base = buffer.data();
+        length = buffer.size();
+#endif
+        return true;
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+// Validated, zero-copy access to the arrays of a binary grid snapshot
+class GridView {
+private:
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    uint64_t nodeCount = 0, lineCount = 0;
+    uint64_t offsets[13] = {};
+
+    template <typename T>
+    const T* section(int k) const { return reinterpret_cast<const T*>(file.data() + offsets[k]); }
+
+public:
+    // Does the file start with the snapshot magic?
+    static bool isSnapshot(const string& filename) {
+        ifstream in(filename, ios::binary);
+        char magic[8];
+        return in.read(magic, 8) && memcmp(magic, snapshotMagic, 8) == 0;
+    }
+
+    bool open(const string& filename, ostream& messages = cout) {
+        if (!file.open(filename, messages)) return false;
+        if (file.size() < sizeof(SnapshotHeader) || memcmp(file.data(), snapshotMagic, 8) != 0) {
+            messages << "Not a grid snapshot: " << filename << "\n";
+            return false;
+        }
+        header = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (header->byteOrder != snapshotByteOrder) {
+            messages << "Snapshot " << filename << " was written with a different byte order.\n";
+            return false;
+        }
+        if (header->version != snapshotVersion) {
+            messages << "Unsupported snapshot version " << header->version << " in " << filename
+                 << " (expected " << snapshotVersion << ").\n";
+            return false;
+        }
+        nodeCount = header->numNodes;
+        lineCount = header->numLines;
+        if (nodeCount == 0 || nodeCount > static_cast<uint64_t>(numeric_limits<int>::max())
+            || lineCount > static_cast<uint64_t>(numeric_limits<int>::max() / 2)
+            || header->nameBytes > numeric_limits<uint32_t>::max()) {
+            messages << "Invalid element counts in snapshot " << filename << ".\n";
+            return false;
+        }
+        SnapshotLayout layout(nodeCount, lineCount, header->nameBytes);
+        if (header->fileSize != layout.end || file.size() != layout.end) {
+            messages << "Snapshot " << filename << " is truncated or has trailing data.\n";
+            return false;
+        }
+        if (snapshotChecksum(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader)) != header->checksum) {
+            messages << "Checksum mismatch in snapshot " << filename << ".\n";
+            return false;
+        }
+        uint64_t all[13] = {layout.nodeCapacity, layout.nodeLoad, layout.nodeGeneration, layout.nodeActive, layout.names,
+                            layout.lines, layout.lineCapacity, layout.lineLoad, layout.lineActive,
+                            layout.rowStart, layout.adjacency, layout.nameTable, layout.end};
+        memcpy(offsets, all, sizeof(all));
+
+        // The checksum guards against corruption; these guard the indices we trust
+        int n = numNodes(), m = numLines();
+        for (int id = 0; id < m; id++) {
+            const Line& l = lines()[id];
+            if (l.from < 0 || l.from >= n || l.to < 0 || l.to >= n) {
+                messages << "Invalid line " << id << " in snapshot " << filename << ".\n";
+                return false;
+            }
+        }
+        const int* rows = rowStart();
+        bool topologyOk = rows[0] == 0 && rows[n] == 2 * m;
+        for (int i = 0; i < n && topologyOk; i++) topologyOk = rows[i] <= rows[i + 1];
+        for (int k = 0; k < 2 * m && topologyOk; k++) {
+            topologyOk = adjacency()[k].to >= 0 && adjacency()[k].to < n && adjacency()[k].line >= 0 && adjacency()[k].line < m;
+        }
+        for (int i = 0; i < n && topologyOk; i++) {
+            topologyOk = static_cast<uint64_t>(names()[i].offset) + names()[i].length <= header->nameBytes;
+        }
+        if (!topologyOk) {
+            messages << "Invalid topology or name table in snapshot " << filename << ".\n";
+            return false;
+        }
+        return true;
+    }
+
+    int numNodes() const { return static_cast<int>(nodeCount); }
+    int numLines() const { return static_cast<int>(lineCount); }
+    const double* nodeCapacity() const { return section<double>(0); }
+    const double* nodeLoad() const { return section<double>(1); }
+    const double* nodeGeneration() const { return section<double>(2); }
+    const char* nodeActive() const { return section<char>(3); }
+    const NameRef* names() const { return section<NameRef>(4); }
+    const Line* lines() const { return section<Line>(5); }
+    const double* lineCapacity() const { return section<double>(6); }
+    const double* lineLoad() const { return section<double>(7); }
+    const char* lineActive() const { return section<char>(8); }
+    const int* rowStart() const { return section<int>(9); }
+    const Adjacent* adjacency() const { return section<Adjacent>(10); }
+    string nodeName(int i) const { return string(section<char>(11) + names()[i].offset, names()[i].length); }
+};
+
+// Cursor over a text buffer for the fast loaders. Numbers are read with
+// from_chars; like iostreams, fields may be separated by any blanks.
+class TextCursor {
+private:
+    const char* p;
+    const char* end;
+
+public:
+    TextCursor(const char* begin, const char* finish) : p(begin), end(finish) {}
+    bool atEnd() const { return p >= end; }
+    const char* position() const { return p; }
+    const char* limit() const { return end; }
+
+    // Take the next line, without its terminator
+    TextCursor nextLine() {
+        const char* begin = p;
+        const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+        return TextCursor(begin, newline ? newline : end);
+    }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) p++;
+    }
+
+    template <typename T>
+    bool number(T& value) {
+        skipSpace();
+        if (p < end && *p == '+') p++;
+        from_chars_result r = from_chars(p, end, value);
+        if (r.ec != errc()) return false;
+        p = r.ptr;
+        return true;
+    }
+
+    bool word(string& out) {
+        skipSpace();
+        const char* begin = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\v' && *p != '\f') p++;
+        out.assign(begin, p);
+        return p > begin;
+    }
+};
+
+// Reads a text file one line at a time through a fixed-size buffer, which
+// only grows for a line longer than itself, so memory stays bounded
+class ChunkedLineReader {
+private:
+    ifstream in;
+    vector<char> buffer;
+    size_t begin = 0, end = 0; // Unread bytes in buffer
+    bool exhausted = false;
+
+public:
+    explicit ChunkedLineReader(const string& filename, size_t chunk = 1 << 20)
+        : in(filename, ios::binary), buffer(chunk) {}
+
+    bool isOpen() const { return in.is_open(); }
+
+    // Take the next line, without its terminator; false at the end of the file
+    bool next(TextCursor& line) {
+        while (true) {
+            const char* data = buffer.data();
+            const char* newline = static_cast<const char*>(memchr(data + begin, '\n', end - begin));
+            if (newline) {
+                line = TextCursor(data + begin, newline);
+                begin = newline - data + 1;
+                return true;
+            }
+            if (exhausted) {
+                if (begin == end) return false;
+                line = TextCursor(data + begin, data + end);
+                begin = end;
+                return true;
+            }
+            memmove(buffer.data(), buffer.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            if (end == buffer.size()) buffer.resize(2 * buffer.size());
+            in.read(buffer.data() + end, buffer.size() - end);
+            end += in.gcount();
+            exhausted = !in;
+        }
+    }
+};
+
+// One line of the edge section, parsed but not yet validated
+struct ParsedEdge {
+    long long u, v; // Range checked by the loader, whatever its index type
+    double load, capacity;
+    double reactance; // Optional fifth field, 1 if absent
+    bool ok; // All four required fields were read
+};
+
+// Parse up to wanted edge lines from [begin, end). Large inputs are cut into
+// chunks at line boundaries and parsed on the shared pool; the chunks are
+// joined in order, so record k always comes from line k of the section.
+inline vector<ParsedEdge> parseEdgeLines(const char* begin, const char* end, size_t wanted) {
+    const size_t chunkBytes = 1 << 20;
+    size_t bytes = end - begin;
+    size_t chunks = 1;
+    if (bytes >= 2 * chunkBytes && defaultPool().size() > 1) chunks = min(bytes / chunkBytes, 4 * size_t(defaultPool().size()));
+    vector<const char*> cut(chunks + 1, end);
+    cut[0] = begin;
+    for (size_t c = 1; c < chunks; c++) {
+        const char* guess = max(begin + bytes / chunks * c, cut[c - 1]);
+        const char* newline = static_cast<const char*>(memchr(guess, '\n', end - guess));
+        cut[c] = newline ? newline + 1 : end;
+    }
+    vector<vector<ParsedEdge>> parts(chunks);
+    auto parse = [&](unsigned, size_t c) {
+        TextCursor text(cut[c], cut[c + 1]);
+        parts[c].reserve((cut[c + 1] - cut[c]) / 16);
+        while (!text.atEnd()) {
+            TextCursor row = text.nextLine();
+            ParsedEdge e;
+            e.ok = row.number(e.u) && row.number(e.v) && row.number(e.load) && row.number(e.capacity);
+            if (!row.number(e.reactance)) e.reactance = 1.0;
+            parts[c].push_back(e);
+        }
+    };
+    if (chunks > 1) {
+        defaultPool().parallelFor(chunks, parse);
+    } else {
+        parse(0, 0);
+    }
+    vector<ParsedEdge> edges = move(parts[0]);
+    for (size_t c = 1; c < chunks && edges.size() < wanted; c++) edges.insert(edges.end(), parts[c].begin(), parts[c].end());
+    if (edges.size() > wanted) edges.resize(wanted);
+    return edges;
+}
+
+// A numeric matrix from a MATPOWER case file, one row per record
+struct MatpowerTable {
+    vector<vector<double>> rows;
+    vector<int> lineNumbers; // Source line of each row
+};
+
+// Read the matrix assigned to mpc.<field>; returns false if it is missing or malformed
+inline bool readMatpowerTable(const char* data, const char* end, const string& field, MatpowerTable& table,
+                              bool required = true, ostream& messages = cout) {
+    string key = "mpc." + field;
+    const char* p = data;
+    while (true) {
+        p = search(p, end, key.begin(), key.end());
+        if (p == end) {
+            if (!required) return true;
+            messages << "Missing " << key << " table in case file.\n";
+            return false;
+        }
+        const char* after = p + key.size();
+        while (after < end && (*after == ' ' || *after == '\t')) after++;
+        if (after < end && *after == '=') {
+            p = after + 1;
+            break;
+        }
+        p = after;
+    }
+    int lineNumber = 1 + static_cast<int>(count(data, p, '\n'));
+    while (p < end && *p != '[') {
+        if (*p == '\n') lineNumber++;
+        p++;
+    }
+    if (p == end) {
+        messages << "Expected '[' after " << key << " at line " << lineNumber << ".\n";
+        return false;
+    }
+    p++;
+    vector<double> row;
+    int rowLine = lineNumber;
+    auto endRow = [&]() {
+        if (!row.empty()) {
+            table.rows.push_back(move(row));
+            table.lineNumbers.push_back(rowLine);
+            row.clear();
+        }
+    };
+    while (p < end && *p != ']') {
+        char c = *p;
+        if (c == '%') {
+            while (p < end && *p != '\n') p++;
+        } else if (c == '\n' || c == ';') {
+            endRow();
+            if (c == '\n') lineNumber++;
+            p++;
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == ',') {
+            p++;
+        } else {
+            if (row.empty()) rowLine = lineNumber;
+            double value;
+            if (c == '+') p++;
+            from_chars_result r = from_chars(p, end, value);
+            if (r.ec != errc()) {
+                messages << "Invalid number in " << key << " at line " << lineNumber << ".\n";
+                return false;
+            }
+            row.push_back(value);
+            p = r.ptr;
+        }
+    }
+    if (p == end) {
+        messages << "Missing ']' closing " << key << ".\n";
+        return false;
+    }
+    endRow();
+    return true;
+}
+
+// Sparse LDL^T factorization of the DC susceptance matrix B = A^T diag(1/x) A
+// over the lines in service. The best-connected node of each island is
+// grounded as its slack, and the rest are eliminated in minimum degree order
+// (Tinney scheme 2) to keep fill-in low.
+template <typename Index>
+class BasicDcFactor {
+private:
+    using Line = BasicLine<Index>;
+    using Adjacent = BasicAdjacent<Index>;
+
+    Index n = 0;
+    vector<Index> order; // Elimination position -> node
+    vector<Index> position; // Node -> elimination position
+    vector<char> slack;
+    vector<Index> Lp, Li; // Strictly lower triangle of L by columns
+    vector<double> Lx, D;
+
+    void orderNodes(const vector<Index>& rowStart, const vector<Adjacent>& adjacency, const vector<char>& inService) {
+        // Pick the slack of each island
+        slack.assign(n, false);
+        vector<Index> degree(n, 0), island(n, -1), queue;
+        for (Index v = 0; v < n; v++) {
+            for (Index k = rowStart[v]; k < rowStart[v + 1]; k++) degree[v] += inService[adjacency[k].line];
+        }
+        for (Index start = 0; start < n; start++) {
+            if (island[start] != -1) continue;
+            Index best = start;
+            island[start] = start;
+            queue.assign(1, start);
+            for (size_t head = 0; head < queue.size(); head++) {
+                Index v = queue[head];
+                if (degree[v] > degree[best]) best = v;
+                for (Index k = rowStart[v]; k < rowStart[v + 1]; k++) {
+                    const Adjacent& a = adjacency[k];
+                    if (inService[a.line] && island[a.to] == -1) {
+                        island[a.to] = start;
+                        queue.push_back(a.to);
+                    }
+                }
+            }
+            slack[best] = true;
+        }
+
+        // Minimum degree on the elimination graph of the non-slack nodes:
+        // eliminating v joins all of its remaining neighbours into a clique
+        vector<vector<Index>> graph(n);
+        BasicIndexedMinHeap<Index> byDegree(n);
+        order.clear();
+        for (Index v = 0; v < n; v++) {
+            if (slack[v]) {
+                order.push_back(v);
+                continue;
+            }
+            for (Index k = rowStart[v]; k < rowStart[v + 1]; k++) {
+                const Adjacent& a = adjacency[k];
+                if (inService[a.line] && !slack[a.to]) graph[v].push_back(a.to);
+            }
+            sort(graph[v].begin(), graph[v].end());
+            graph[v].erase(unique(graph[v].begin(), graph[v].end()), graph[v].end());
+            byDegree.push(v, static_cast<double>(graph[v].size()));
+        }
+        vector<Index> merged;
+        while (!byDegree.empty()) {
+            Index v = byDegree.pop();
+            order.push_back(v);
+            const vector<Index>& clique = graph[v];
+            for (Index u : clique) {
+                merged.clear();
+                set_union(graph[u].begin(), graph[u].end(), clique.begin(), clique.end(), back_inserter(merged));
+                merged.erase(remove_if(merged.begin(), merged.end(), [&](Index w) { return w == u || w == v; }), merged.end());
+                graph[u].swap(merged);
+                byDegree.push(u, static_cast<double>(graph[u].size()));
+            }
+            vector<Index>().swap(graph[v]);
+        }
+        position.assign(n, 0);
+        for (Index k = 0; k < n; k++) position[order[k]] = k;
+    }
+
+    // Numeric factorization in the current order
+    bool factorize(const vector<Index>& rowStart, const vector<Adjacent>& adjacency,
+                   const vector<Line>& lines, const vector<char>& inService) {
+        // Upper triangle of the permuted matrix by columns; slack rows are identity
+        vector<Index> Ap(n + 1, 0), Ai;
+        vector<double> Ax;
+        for (Index k = 0; k < n; k++) {
+            Index v = order[k];
+            double diagonal = 0.0;
+            for (Index j = rowStart[v]; j < rowStart[v + 1]; j++) {
+                const Adjacent& a = adjacency[j];
+                if (!inService[a.line]) continue;
+                double b = 1.0 / lines[a.line].reactance;
+                diagonal += b;
+                if (!slack[v] && !slack[a.to] && position[a.to] < k) {
+                    Ai.push_back(position[a.to]);
+                    Ax.push_back(-b);
+                }
+            }
+            Ai.push_back(k);
+            Ax.push_back(slack[v] ? 1.0 : diagonal);
+            Ap[k + 1] = static_cast<Index>(Ai.size());
+        }
+
+        // Symbolic pass: elimination tree and column counts of L
+        vector<Index> parent(n), flag(n), count(n, 0);
+        for (Index k = 0; k < n; k++) {
+            parent[k] = -1;
+            flag[k] = k;
+            for (Index p = Ap[k]; p < Ap[k + 1]; p++) {
+                for (Index i = Ai[p]; i < k && flag[i] != k; i = parent[i]) {
+                    if (parent[i] == -1) parent[i] = k;
+                    count[i]++;
+                    flag[i] = k;
+                }
+            }
+        }
+        Lp.assign(n + 1, 0);
+        for (Index k = 0; k < n; k++) Lp[k + 1] = Lp[k] + count[k];
+        Li.resize(Lp[n]);
+        Lx.resize(Lp[n]);
+        D.assign(n, 0.0);
+
+        // Numeric pass, one row of L at a time (up-looking)
+        vector<double> y(n, 0.0);
+        vector<Index> pattern(n);
+        fill(count.begin(), count.end(), 0);
+        for (Index k = 0; k < n; k++) {
+            Index top = n;
+            flag[k] = k;
+            for (Index p = Ap[k]; p < Ap[k + 1]; p++) {
+                Index i = Ai[p];
+                y[i] += Ax[p];
+                Index len = 0;
+                for (; flag[i] != k; i = parent[i]) {
+                    pattern[len++] = i;
+                    flag[i] = k;
+                }
+                while (len > 0) pattern[--top] = pattern[--len];
+            }
+            D[k] = y[k];
+            y[k] = 0.0;
+            for (; top < n; top++) {
+                Index i = pattern[top];
+                double yi = y[i];
+                y[i] = 0.0;
+                Index end = Lp[i] + count[i];
+                for (Index p = Lp[i]; p < end; p++) y[Li[p]] -= Lx[p] * yi;
+                double lki = yi / D[i];
+                D[k] -= lki * yi;
+                Li[end] = k;
+                Lx[end] = lki;
+                count[i]++;
+            }
+            if (!(D[k] > 0)) return false;
+        }
+        return true;
+    }
+
+public:
+    // Factor B for the lines marked in service; false if B is not positive definite
+    bool build(Index numNodes, const vector<Index>& rowStart, const vector<Adjacent>& adjacency,
+               const vector<Line>& lines, const vector<char>& inService) {
+        n = numNodes;
+        orderNodes(rowStart, adjacency, inService);
+        return factorize(rowStart, adjacency, lines, inService);
+    }
+
+    // Refactor in base's order after taking out lines that split no island,
+    // skipping the ordering, which dominates the cost of build
+    bool rebuild(const BasicDcFactor& base, const vector<Index>& rowStart, const vector<Adjacent>& adjacency,
+                 const vector<Line>& lines, const vector<char>& inService) {
+        n = base.n;
+        order = base.order;
+        position = base.position;
+        slack = base.slack;
+        return factorize(rowStart, adjacency, lines, inService);
+    }
+
+    // Solve B theta = x in place (x indexed by node); slack angles come out zero
+    void solve(vector<double>& x, vector<double>& work) const {
+        work.resize(n);
+        for (Index k = 0; k < n; k++) work[k] = slack[order[k]] ? 0.0 : x[order[k]];
+        for (Index j = 0; j < n; j++) {
+            for (Index p = Lp[j]; p < Lp[j + 1]; p++) work[Li[p]] -= Lx[p] * work[j];
+        }
+        for (Index j = 0; j < n; j++) work[j] /= D[j];
+        for (Index j = n - 1; j >= 0; j--) {
+            for (Index p = Lp[j]; p < Lp[j + 1]; p++) work[j] -= Lx[p] * work[Li[p]];
+        }
+        for (Index k = 0; k < n; k++) x[order[k]] = work[k];
+    }
+
+    size_t factorSize() const { return Lx.size() + D.size(); }
+};
+
+// DC line flows over one cascade. A failed line's flow moves onto the rest of
+// the network by its line outage distribution factors, computed from the
+// factored B with earlier outages folded in as a low-rank (Woodbury) update;
+// after maxRank such outages B is refactored without them. A line whose loss
+// splits an island has no LODF: its flow is dropped and its endpoints absorb
+// the imbalance, so it stays in B, where it can no longer carry flow.
+// A tracker is bound to one grid's topology and restarted for each cascade;
+// its arrays keep their storage, so only a refactorization allocates.
+template <typename Real, typename Index>
+class BasicDcFlowTracker {
+private:
+    using Line = BasicLine<Index>;
+    using Adjacent = BasicAdjacent<Index>;
+    using DcFactor = BasicDcFactor<Index>;
+    static const int maxRank = 32;
+    const vector<Line>& lines;
+    const vector<Index>& rowStart;
+    const vector<Adjacent>& adjacency;
+    shared_ptr<const DcFactor> factor;
+    vector<double> flow; // Signed flow, positive from -> to
+    vector<char> inMatrix; // Lines still present in the factored B
+    vector<Index> removed; // Outages folded in since the last factorization
+    vector<vector<double>> W; // B^-1 a_s for each removed line s; entries past removed.size() are spare
+    vector<double> C; // Capacitance matrix diag(x_s) - U^T W, row-major
+    vector<double> base, z, work;
+    vector<double> grown, m, rhs; // Buffers for updating and solving the capacitance system
+
+    double across(const vector<double>& theta, Index id) const {
+        return theta[lines[id].from] - theta[lines[id].to];
+    }
+
+    // z = (B - U diag(b) U^T)^-1 a_k for the current outages; base keeps B^-1 a_k
+    void solveOutaged(Index k) {
+        Index n = static_cast<Index>(rowStart.size()) - 1;
+        base.assign(n, 0.0);
+        base[lines[k].from] = 1.0;
+        base[lines[k].to] -= 1.0;
+        factor->solve(base, work);
+        z = base;
+        Index r = static_cast<Index>(removed.size());
+        if (r == 0) return;
+        m.assign(C.begin(), C.end());
+        rhs.resize(r);
+        for (Index i = 0; i < r; i++) rhs[i] = across(z, removed[i]);
+        // Gaussian elimination with partial pivoting on the small r x r system
+        for (Index c = 0; c < r; c++) {
+            Index pivot = c;
+            for (Index i = c + 1; i < r; i++) {
+                if (fabs(m[i * r + c]) > fabs(m[pivot * r + c])) pivot = i;
+            }
+            if (pivot != c) {
+                for (Index j = 0; j < r; j++) swap(m[c * r + j], m[pivot * r + j]);
+                swap(rhs[c], rhs[pivot]);
+            }
+            for (Index i = c + 1; i < r; i++) {
+                double f = m[i * r + c] / m[c * r + c];
+                for (Index j = c; j < r; j++) m[i * r + j] -= f * m[c * r + j];
+                rhs[i] -= f * rhs[c];
+            }
+        }
+        for (Index c = r - 1; c >= 0; c--) {
+            for (Index j = c + 1; j < r; j++) rhs[c] -= m[c * r + j] * rhs[j];
+            rhs[c] /= m[c * r + c];
+        }
+        for (Index i = 0; i < r; i++) {
+            for (Index v = 0; v < n; v++) z[v] += W[i][v] * rhs[i];
+        }
+    }
+
+    // PTDF of line k on itself; expects z from solveOutaged(k)
+    double selfFactor(Index k) const { return across(z, k) / lines[k].reactance; }
+
+    // Taking out k would split its island
+    bool isBridge(Index k) const { return 1.0 - selfFactor(k) < 1e-9; }
+
+    // Fold outage k into the Woodbury terms, refactoring when the rank is full.
+    // Expects base = B^-1 a_k from solveOutaged.
+    void removeFromMatrix(Index k) {
+        inMatrix[k] = false;
+        if (static_cast<int>(removed.size()) == maxRank) {
+            auto rebuilt = make_shared<DcFactor>();
+            rebuilt->rebuild(*factor, rowStart, adjacency, lines, inMatrix);
+            factor = rebuilt;
+            removed.clear();
+            C.clear();
+            return;
+        }
+        Index r = static_cast<Index>(removed.size());
+        grown.resize((r + 1) * (r + 1));
+        for (Index i = 0; i < r; i++) {
+            for (Index j = 0; j < r; j++) grown[i * (r + 1) + j] = C[i * r + j];
+        }
+        for (Index i = 0; i < r; i++) {
+            grown[i * (r + 1) + r] = -across(base, removed[i]);
+            grown[r * (r + 1) + i] = -across(W[i], k);
+        }
+        grown[r * (r + 1) + r] = lines[k].reactance - across(base, k);
+        C.swap(grown);
+        removed.push_back(k);
+        if (W.size() < removed.size()) W.emplace_back();
+        W[r] = base;
+    }
+
+public:
+    BasicDcFlowTracker(const vector<Line>& l, const vector<Index>& rows, const vector<Adjacent>& adj)
+        : lines(l), rowStart(rows), adjacency(adj) {}
+
+    bool uses(const vector<Line>& l) const { return &lines == &l; }
+
+    // Start a cascade on st from the shared factor of the base grid. Loads
+    // carry no direction, so each is taken as a flow from -> to.
+    void start(shared_ptr<const DcFactor> baseFactor, const vector<char>& baseInService, const BasicGridState<Real, Index>& st) {
+        factor = move(baseFactor);
+        flow.assign(st.lineLoads.begin(), st.lineLoads.end());
+        inMatrix = baseInService;
+        removed.clear();
+        C.clear();
+        // Lines already out in st but present in the shared factor
+        for (Index id = 0; id < static_cast<Index>(lines.size()); id++) {
+            if (inMatrix[id] && !st.lineActive[id]) {
+                flow[id] = 0.0;
+                solveOutaged(id);
+                if (!isBridge(id)) removeFromMatrix(id);
+            }
+        }
+    }
+
+    // Line k has just failed: move its flow onto the remaining lines of st
+    void outage(Index k, BasicGridState<Real, Index>& st, vector<Index>& touched, BasicCascadeObserver<Index>* observer) {
+        GRID_TIME_SAMPLED(RedistributionPhase);
+        GRID_COUNT(Redistributions, 1);
+        touched.clear();
+        double lost = flow[k];
+        flow[k] = 0.0;
+        if (!inMatrix[k]) return;
+        solveOutaged(k);
+        if (isBridge(k)) return; // k was the only path: the flow is dropped
+        removeFromMatrix(k);
+        double shift = lost / (1.0 - selfFactor(k));
+        for (Index id = 0; id < static_cast<Index>(lines.size()); id++) {
+            if (!st.lineActive[id] || id == k) continue;
+            double delta = across(z, id) / lines[id].reactance * shift;
+            if (delta == 0.0) continue;
+            flow[id] += delta;
+            double oldLoad = st.lineLoads[id];
+            st.setLineLoad(id, fabs(flow[id]));
+            touched.push_back(id);
+            if (observer) observer->onRedistribute(lines[id].from, id, st.lineLoads[id] - oldLoad);
+        }
+    }
+};
+
+// Working memory of runCascade, owned by the caller so that it outlives one
+// cascade. Every buffer is cleared rather than freed between steps, so a
+// worker that keeps one scratch and one result across trials stops
+// allocating once they have grown to the largest cascade it has run.
+template <typename Real, typename Index>
+struct BasicCascadeScratch {
+    BasicIndexedMinHeap<Index> pending; // Overloaded elements awaiting failure
+    vector<Real> nodeScale, lineScale; // Random load multipliers
+    vector<Index> overloadedNodes, overloadedLines;
+    vector<Index> touched; // Lines whose load a failure changed
+    vector<Index> tripped; // Lines of a failing node
+    vector<Index> round; // Keys failing together in a round
+    vector<vector<BasicLoadShare<Index>>> roundShares; // Per failed line of a round
+    unique_ptr<BasicDcFlowTracker<Real, Index>> dc; // Made on the first DC cascade
+    // Island timeline replay
+    BasicUnionFind<Index> uf;
+    vector<char> nodeOn, lineOn;
+    vector<Index> roots;
+};
+
+using CascadeScratch = BasicCascadeScratch<double, int>;
+
+// Graph class to represent the electric grid
+template <typename Real, typename Index>
+class BasicGraph {
+public:
+    using RealType = Real;
+    using IndexType = Index;
+    using Line = BasicLine<Index>;
+    using Adjacent = BasicAdjacent<Index>;
+    using GridState = BasicGridState<Real, Index>;
+    using ContingencyScratch = BasicContingencyScratch<Real, Index>;
+    using CascadeScratch = BasicCascadeScratch<Real, Index>;
+    using Contingency = BasicContingency<Index>;
+    using CascadeOptions = BasicCascadeOptions<Index>;
+    using CascadeResult = BasicCascadeResult<Index>;
+    using CascadeObserver = BasicCascadeObserver<Index>;
+    using FailureEvent = BasicFailureEvent<Index>;
+    using LoadShare = BasicLoadShare<Index>;
+    using ComponentLabels = BasicComponentLabels<Index>;
+    using IslandStep = BasicIslandStep<Index>;
+    using CriticalLine = BasicCriticalLine<Index>;
+    using CriticalReport = BasicCriticalReport<Index>;
+    using CutAnalysis = BasicCutAnalysis<Index>;
+
+private:
+    using DcFactor = BasicDcFactor<Index>;
+    using DcFlowTracker = BasicDcFlowTracker<Real, Index>;
+    using LoadKernels = BasicLoadKernels<Real, Index>;
+
+    vector<string> nodeNames; // Cold: only read for output
+    AlignedVector<Real> nodeCapacity; // Max capacity in MW
+    AlignedVector<Real> nodeGeneration; // Generation available in MW, for island balancing; selfSupplied if not given
+    vector<Line> lines; // One record per transmission line, indexed by line ID
+    AlignedVector<Real> lineCapacity; // Max capacity in MW, indexed by line ID
+    Index numNodes;
+    GridState state; // Current loads and statuses
+    // Endpoint pair of a line, smaller node first, for duplicate checks
+    using LineKey = pair<Index, Index>;
+    struct LineKeyHash {
+        size_t operator()(const LineKey& k) const {
+            return hash<uint64_t>()(static_cast<uint64_t>(k.first) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(k.second));
+        }
+    };
+    unordered_set<LineKey, LineKeyHash> lineKeys; // Endpoint pairs already present, to reject duplicates
+    // CSR adjacency: neighbours of u are adjacency[rowStart[u] .. rowStart[u + 1]).
+    // Rebuilt lazily after lines are added, so it is mutable for const readers.
+    mutable vector<Index> rowStart;
+    mutable vector<Adjacent> adjacency;
+    mutable bool topologyDirty = true;
+    // DC susceptance factorization for the lines in service in state, built on first use
+    mutable shared_ptr<const DcFactor> dcFactor;
+    mutable vector<char> dcInService;
+    bool verbose = true; // Print load/save status messages
+    ostream* messages = &cout; // Load errors, invalid edits and status messages
+
+    // Stand-in for a MATPOWER rating of 0, which means "unlimited"
+    static constexpr double unlimitedRating = 9900.0;
+    // Floor for zero-impedance MATPOWER branches, which the DC model cannot represent
+    static constexpr double minReactance = 1e-4;
+    // Margin searches stop bisecting at this bracket width, in percentage points
+    static constexpr double marginTolerance = 0.01;
+    // Rounds with fewer failed lines compute their redistributions on the calling thread
+    static const size_t parallelRoundLines = 256;
+    // Under-frequency load shedding: each stage sheds this share of an island's
+    // demand, and an island still short after the last stage blacks out
+    static constexpr double uflsStageShare = 0.1;
+    static const int uflsStages = 5;
+    // Generation of a node without its own figure: it supplies whatever it demands
+    static constexpr double selfSupplied = -1.0;
+    // Fewer islands than this are balanced on the calling thread
+    static const size_t parallelIslands = 64;
+
+    void reserveLines(size_t m) {
+        lines.reserve(m);
+        lineCapacity.reserve(m);
+        state.lineActive.reserve(m);
+        state.lineLoads.reserve(m);
+        lineKeys.reserve(m);
+    }
+
+    static LineKey lineKey(Index u, Index v) { return {min(u, v), max(u, v)}; }
+
+    // Rebuild the CSR adjacency with a counting sort over line IDs
+    void ensureTopology() const {
+        if (!topologyDirty) return;
+        rowStart.assign(numNodes + 1, 0);
+        for (const Line& l : lines) {
+            rowStart[l.from + 1]++;
+            rowStart[l.to + 1]++;
+        }
+        for (Index i = 0; i < numNodes; i++) rowStart[i + 1] += rowStart[i];
+        adjacency.resize(2 * lines.size());
+        vector<Index> fill(rowStart.begin(), rowStart.end() - 1);
+        for (Index id = 0; id < static_cast<Index>(lines.size()); id++) {
+            adjacency[fill[lines[id].from]++] = {lines[id].to, id};
+            adjacency[fill[lines[id].to]++] = {lines[id].from, id};
+        }
+        topologyDirty = false;
+    }
+
+    // Factor B once per topology; parallel callers must build it beforehand
+    shared_ptr<const DcFactor> ensureDcFactor() const {
+        ensureTopology();
+        if (!dcFactor) {
+            auto built = make_shared<DcFactor>();
+            dcInService = state.lineActive.toBytes();
+            built->build(numNodes, rowStart, adjacency, lines, dcInService);
+            dcFactor = built;
+        }
+        return dcFactor;
+    }
+
+    // Label components with an explicit stack, numbering them by lowest node
+    void labelSerial(const GridState& st, ComponentLabels& cc) const {
+        Index count = 0;
+        vector<Index>& stack = cc.members; // Free until the nodes are sorted into it
+        stack.clear();
+        for (Index i = 0; i < numNodes; i++) {
+            if (!st.nodeActive[i] || cc.label[i] != -1) continue;
+            cc.label[i] = count;
+            stack.push_back(i);
+            while (!stack.empty()) {
+                Index v = stack.back();
+                stack.pop_back();
+                for (Index k = rowStart[v]; k < rowStart[v + 1]; k++) {
+                    const Adjacent& a = adjacency[k];
+                    if (st.lineActive[a.line] && st.nodeActive[a.to] && cc.label[a.to] == -1) {
+                        cc.label[a.to] = count;
+                        stack.push_back(a.to);
+                    }
+                }
+            }
+            count++;
+        }
+        cc.offsets.assign(count + 1, 0);
+    }
+
+    // Label components with a lock-free union-find spread over the pool.
+    // Roots are always hooked under the smaller index, so every tree is rooted
+    // at its lowest node and the numbering matches labelSerial.
+    void labelParallel(const GridState& st, ComponentLabels& cc, WorkStealingPool& pool) const {
+        const size_t chunk = 1 << 14;
+        Index m = static_cast<Index>(lines.size());
+        unique_ptr<atomic<Index>[]> parent(new atomic<Index>[numNodes]);
+        auto find = [&](Index x) {
+            while (true) {
+                Index p = parent[x].load(memory_order_relaxed);
+                if (p == x) return x;
+                Index gp = parent[p].load(memory_order_relaxed);
+                if (gp != p) parent[x].compare_exchange_weak(p, gp, memory_order_relaxed); // Path halving
+                x = gp;
+            }
+        };
+        auto chunks = [&](size_t n) { return (n + chunk - 1) / chunk; };
+        pool.parallelFor(chunks(numNodes), [&](unsigned, size_t c) {
+            Index end = static_cast<Index>(min<size_t>(numNodes, (c + 1) * chunk));
+            for (Index i = static_cast<Index>(c * chunk); i < end; i++) parent[i].store(i, memory_order_relaxed);
+        });
+        pool.parallelFor(chunks(m), [&](unsigned, size_t c) {
+            Index end = static_cast<Index>(min<size_t>(m, (c + 1) * chunk));
+            for (Index id = static_cast<Index>(c * chunk); id < end; id++) {
+                const Line& l = lines[id];
+                if (!st.lineActive[id] || !st.nodeActive[l.from] || !st.nodeActive[l.to]) continue;
+                Index u = l.from, v = l.to;
+                while (true) {
+                    u = find(u);
+                    v = find(v);
+                    if (u == v) break;
+                    if (u < v) swap(u, v);
+                    Index expected = u;
+                    if (parent[u].compare_exchange_strong(expected, v, memory_order_relaxed)) break;
+                }
+            }
+        });
+        pool.parallelFor(chunks(numNodes), [&](unsigned, size_t c) {
+            Index end = static_cast<Index>(min<size_t>(numNodes, (c + 1) * chunk));
+            for (Index i = static_cast<Index>(c * chunk); i < end; i++) {
+                if (st.nodeActive[i]) cc.label[i] = find(i);
+            }
+        });
+
+        // Roots in ascending order become components 0, 1, ...
+        Index count = 0;
+        for (Index i = 0; i < numNodes; i++) {
+            if (cc.label[i] == i) parent[i].store(count++, memory_order_relaxed);
+        }
+        pool.parallelFor(chunks(numNodes), [&](unsigned, size_t c) {
+            Index end = static_cast<Index>(min<size_t>(numNodes, (c + 1) * chunk));
+            for (Index i = static_cast<Index>(c * chunk); i < end; i++) {
+                if (cc.label[i] != -1) cc.label[i] = parent[cc.label[i]].load(memory_order_relaxed);
+            }
+        });
+        cc.offsets.assign(count + 1, 0);
+    }
+
+    // Smallest increase at which an active element reaches its capacity before
+    // anything fails, drawing random factors in the same order as runCascade
+    double firstOverloadPercent(const GridState& st, const CascadeOptions& options) const {
+        Philox4x32 rng(options.seed, options.trial);
+        double best = numeric_limits<double>::infinity();
+        auto consider = [&](double load, double capacity) {
+            double factor = options.randomLoad ? 0.5 + rng.uniform() : 1.0;
+            if (load >= capacity) best = 0.0;
+            else if (load > 0) best = min(best, (capacity / load - 1) * 100.0 / factor);
+        };
+        for (Index i = 0; i < numNodes; i++) {
+            if (st.nodeActive[i]) consider(st.nodeLoads[i], nodeCapacity[i]);
+        }
+        for (size_t id = 0; id < lines.size(); id++) {
+            if (st.lineActive[id]) consider(st.lineLoads[id], lineCapacity[id]);
+        }
+        return best;
+    }
+
+public:
+    BasicGraph(Index n) : numNodes(n) {
+        nodeNames.resize(n);
+        nodeCapacity.assign(n, 0.0);
+        nodeGeneration.assign(n, selfSupplied);
+        state.nodeActive.assign(n, true);
+        state.nodeLoads.assign(n, 0.0);
+    }
+
+    // Enable or silence load/save status messages
+    void setVerbose(bool on) { verbose = on; }
+    // Send load errors, invalid edits and status messages to out instead of cout
+    void setMessages(ostream& out) { messages = &out; }
+
+    Index getNumNodes() const { return numNodes; }
+    Index getNumLines() const { return static_cast<Index>(lines.size()); }
+    const Line& getLine(Index id) const { return lines[id]; }
+    const GridState& getState() const { return state; }
+    double getNodeCapacity(Index i) const { return nodeCapacity[i]; }
+    // Generation at node i; a self-supplied node generates its base load
+    double getNodeGeneration(Index i) const { return nodeGeneration[i] < 0 ? state.nodeLoads[i] : nodeGeneration[i]; }
+    double getLineCapacity(Index id) const { return lineCapacity[id]; }
+    // Whole arrays, for callers that wrap them without copying
+    const Line* getLines() const { return lines.data(); }
+    const Real* getNodeCapacities() const { return nodeCapacity.data(); }
+    const Real* getLineCapacities() const { return lineCapacity.data(); }
+
+    // Find the ID of the line between u and v, or -1 if there is none
+    Index findLine(Index u, Index v) const {
+        if (u < 0 || u >= numNodes || v < 0 || v >= numNodes) return -1;
+        ensureTopology();
+        for (Index k = rowStart[u]; k < rowStart[u + 1]; k++) {
+            if (adjacency[k].to == v) return adjacency[k].line;
+        }
+        return -1;
+    }
+
+    // Add a node (substation)
+    bool addNode(Index idx, const string& name, double load, double maxCapacity) {
+        if (idx < 0 || idx >= numNodes) {
+            *messages << "Invalid node index: " << idx << ". Must be between 0 and " << (numNodes - 1) << ".\n";
+            return false;
+        }
+        if (load < 0) {
+            *messages << "Invalid load for node " << name << ". Load must be >= 0.\n";
+            return false;
+        }
+        if (maxCapacity <= 0) {
+            *messages << "Invalid max capacity for node " << name << ". Max capacity must be > 0.\n";
+            return false;
+        }
+        if (load > maxCapacity) {
+            *messages << "Invalid load for node " << name << ". Load must be <= max capacity (" << maxCapacity << ").\n";
+            return false;
+        }
+        nodeNames[idx] = name;
+        nodeCapacity[idx] = maxCapacity;
+        nodeGeneration[idx] = selfSupplied; // Until setNodeGeneration says otherwise
+        state.nodeActive.set(idx, true);
+        state.nodeLoads[idx] = load;
+        return true;
+    }
+
+    // Set the generation available at a node
+    bool setNodeGeneration(Index idx, double generation) {
+        if (idx < 0 || idx >= numNodes) {
+            *messages << "Invalid node index: " << idx << ". Must be between 0 and " << (numNodes - 1) << ".\n";
+            return false;
+        }
+        if (generation < 0) {
+            *messages << "Invalid generation for node " << nodeNames[idx] << ". Generation must be >= 0.\n";
+            return false;
+        }
+        nodeGeneration[idx] = generation;
+        return true;
+    }
+
+    // Add an edge (transmission line)
+    bool addEdge(Index from, Index to, double capacity, double currentLoad, double reactance = 1.0) {
+        if (from < 0 || from >= numNodes || to < 0 || to >= numNodes) {
+            *messages << "Invalid node index: " << from << " or " << to << ". Must be between 0 and " << (numNodes - 1) << ".\n";
+            return false;
+        }
+        if (from == to) {
+            *messages << "Self-loops are not allowed: " << from << " to " << to << ".\n";
+            return false;
+        }
+        if (capacity <= 0) {
+            *messages << "Invalid capacity for edge " << from << "-" << to << ". Capacity must be > 0.\n";
+            return false;
+        }
+        if (currentLoad < 0) {
+            *messages << "Invalid load for edge " << from << "-" << to << ". Load must be >= 0.\n";
+            return false;
+        }
+        if (reactance <= 0) {
+            *messages << "Invalid reactance for edge " << from << "-" << to << ". Reactance must be > 0.\n";
+            return false;
+        }
+        if (lineKeys.size() != lines.size()) {
+            // Snapshots load without the key set; rebuild it on the first new line
+            lineKeys.clear();
+            for (const Line& l : lines) lineKeys.insert(lineKey(l.from, l.to));
+        }
+        if (!lineKeys.insert(lineKey(from, to)).second) {
+            *messages << "Duplicate edge between " << from << " and " << to << ".\n";
+            return false;
+        }
+        lines.push_back({from, to, reactance});
+        lineCapacity.push_back(capacity);
+        state.lineActive.push_back(true);
+        state.lineLoads.push_back(currentLoad);
+        topologyDirty = true;
+        dcFactor.reset();
+        return true;
+    }
+
+    // Grids at least this large are labeled in parallel when a pool is given
+    static const int parallelLabelNodes = 1 << 17;
+
+    // Find connected components of the active nodes into cc, reusing its
+    // arrays. Must not be called with a pool from inside one of that pool's jobs.
+    void findComponents(const GridState& st, ComponentLabels& cc, WorkStealingPool* pool = nullptr) const {
+        GRID_TIME(ConnectivityPhase);
+        GRID_COUNT(ConnectivityQueries, 1);
+        ensureTopology();
+        cc.label.assign(numNodes, -1);
+        if (pool && pool->size() > 1 && numNodes >= parallelLabelNodes) {
+            labelParallel(st, cc, *pool);
+        } else {
+            labelSerial(st, cc);
+        }
+
+        // Counting sort of the nodes by label. offsets[c] is the fill cursor
+        // of component c, which leaves it at the start of c + 1; the offsets
+        // are then shifted back up by one.
+        for (Index i = 0; i < numNodes; i++) {
+            if (cc.label[i] != -1) cc.offsets[cc.label[i] + 1]++;
+        }
+        for (size_t c = 0; c < cc.count(); c++) cc.offsets[c + 1] += cc.offsets[c];
+        cc.members.resize(cc.offsets.back());
+        for (Index i = 0; i < numNodes; i++) {
+            if (cc.label[i] != -1) cc.members[cc.offsets[cc.label[i]]++] = i;
+        }
+        for (size_t c = cc.count(); c > 0; c--) cc.offsets[c] = cc.offsets[c - 1];
+        cc.offsets[0] = 0;
+    }
+    ComponentLabels findComponents(const GridState& st, WorkStealingPool* pool = nullptr) const {
+        ComponentLabels cc;
+        findComponents(st, cc, pool);
+        return cc;
+    }
+    ComponentLabels findComponents() const {
+        return findComponents(state, numNodes >= parallelLabelNodes ? &defaultPool() : nullptr);
+    }
+
+    // Check if the active nodes form a single island
+    bool isConnected(const GridState& st) const { return findComponents(st).count() <= 1; }
+    bool isConnected() const { return findComponents().count() <= 1; }
+
+    // Check for overloaded nodes or lines (reported by index and line ID)
+    void checkOverloads(const GridState& st, vector<Index>& overloadedNodes, vector<Index>& overloadedLines) const {
+        GRID_TIME(OverloadScanPhase);
+        GRID_COUNT(OverloadScans, 1);
+        const LoadKernels& kernels = loadKernels<Real, Index>();
+        overloadedNodes.resize(numNodes);
+        overloadedNodes.resize(kernels.overloads(st.nodeLoads.data(), nodeCapacity.data(), st.nodeActive.words(),
+                                                 numNodes, overloadedNodes.data()));
+        overloadedLines.resize(lines.size());
+        overloadedLines.resize(kernels.overloads(st.lineLoads.data(), lineCapacity.data(), st.lineActive.words(),
+                                                 lines.size(), overloadedLines.data()));
+    }
+    void checkOverloads(vector<Index>& overloadedNodes, vector<Index>& overloadedLines) const {
+        checkOverloads(state, overloadedNodes, overloadedLines);
+    }
+
+    // Run a cascade on st with no I/O, leaving st in its final state
+    CascadeResult runCascade(GridState& st, const CascadeOptions& options, CascadeObserver* observer = nullptr) const {
+        CascadeScratch scratch;
+        CascadeResult result;
+        runCascade(st, options, scratch, result, observer);
+        return result;
+    }
+
+    // Run a cascade into result, overwriting it in place. Temporaries live in
+    // scratch, so repeated runs with the same scratch and result, as on a
+    // Monte Carlo worker, make no heap allocations once both have grown.
+    void runCascade(GridState& st, const CascadeOptions& options, CascadeScratch& scratch, CascadeResult& result,
+                    CascadeObserver* observer = nullptr) const {
+        GRID_TIME(CascadePhase);
+        GRID_COUNT(CascadeRuns, 1);
+        ensureTopology();
+        result.events.clear();
+        result.rounds = 0;
+        result.balance.clear();
+        result.transferredDemand = result.droppedDemand = 0;
+        result.nodePeakLoading.resize(numNodes);
+        result.linePeakLoading.resize(lines.size());
+        const double loadIncreasePercent = options.loadIncreasePercent;
+        const bool randomLoad = options.randomLoad;
+        if (observer) observer->onStart(loadIncreasePercent, randomLoad);
+
+        // Apply load increase; random factors 50%-150% come from this trial's stream
+        Philox4x32 rng(options.seed, options.trial);
+        const LoadKernels& kernels = loadKernels<Real, Index>();
+        if (observer) {
+            // Element by element, so the observer sees each change
+            for (Index i = 0; i < numNodes; i++) {
+                if (st.nodeActive[i]) {
+                    double factor = randomLoad ? 0.5 + rng.uniform() : 1.0;
+                    double oldLoad = st.nodeLoads[i];
+                    st.setNodeLoad(i, oldLoad * (1 + loadIncreasePercent / 100.0 * factor));
+                    observer->onNodeLoadIncrease(i, oldLoad, st.nodeLoads[i], factor);
+                }
+            }
+            for (Index id = 0; id < static_cast<Index>(lines.size()); id++) {
+                if (st.lineActive[id]) {
+                    double factor = randomLoad ? 0.5 + rng.uniform() : 1.0;
+                    double oldLoad = st.lineLoads[id];
+                    st.setLineLoad(id, oldLoad * (1 + loadIncreasePercent / 100.0 * factor));
+                    observer->onLineLoadIncrease(id, oldLoad, st.lineLoads[id], factor);
+                }
+            }
+        } else if (loadIncreasePercent != 0) {
+            // Whole arrays at once; random multipliers are drawn in the same order as above
+            st.saveLoads();
+            if (randomLoad) {
+                vector<Real>& nodeScale = scratch.nodeScale;
+                vector<Real>& lineScale = scratch.lineScale;
+                nodeScale.resize(numNodes); // Entries of inactive elements are stale; the kernels skip them
+                lineScale.resize(lines.size());
+                for (Index i = 0; i < numNodes; i++) {
+                    if (st.nodeActive[i]) nodeScale[i] = 1 + loadIncreasePercent / 100.0 * (0.5 + rng.uniform());
+                }
+                for (size_t id = 0; id < lines.size(); id++) {
+                    if (st.lineActive[id]) lineScale[id] = 1 + loadIncreasePercent / 100.0 * (0.5 + rng.uniform());
+                }
+                kernels.scale(st.nodeLoads.data(), nodeScale.data(), 0.0, st.nodeActive.words(), numNodes);
+                kernels.scale(st.lineLoads.data(), lineScale.data(), 0.0, st.lineActive.words(), lines.size());
+            } else {
+                double uniform = 1 + loadIncreasePercent / 100.0;
+                kernels.scale(st.nodeLoads.data(), nullptr, uniform, st.nodeActive.words(), numNodes);
+                kernels.scale(st.lineLoads.data(), nullptr, uniform, st.lineActive.words(), lines.size());
+            }
+        }
+        kernels.ratio(result.nodePeakLoading.data(), st.nodeLoads.data(), nodeCapacity.data(), numNodes);
+        kernels.ratio(result.linePeakLoading.data(), st.lineLoads.data(), lineCapacity.data(), lines.size());
+
+        DcFlowTracker* dc = nullptr;
+        if (options.dcFlow) {
+            if (!scratch.dc || !scratch.dc->uses(lines)) scratch.dc.reset(new DcFlowTracker(lines, rowStart, adjacency));
+            dc = scratch.dc.get();
+            dc->start(ensureDcFactor(), dcInService, st);
+        }
+
+        // Overloaded active elements, keyed by node index or numNodes + line ID.
+        // Loads only change where a line fails, so only those lines are rechecked.
+        BasicIndexedMinHeap<Index>& pending = scratch.pending;
+        pending.reset(numNodes + static_cast<Index>(lines.size()));
+        size_t pendingNodes = 0, pendingLines = 0;
+        auto recheckLine = [&](Index id) {
+            Index key = numNodes + id;
+            if (st.lineActive[id] && st.lineLoads[id] >= lineCapacity[id]) {
+                if (!pending.contains(key)) pendingLines++;
+                pending.push(key, st.lineLoads[id] / lineCapacity[id]);
+                GRID_COUNT(HeapPushes, 1);
+            } else if (pending.contains(key)) {
+                pending.remove(key);
+                pendingLines--;
+                GRID_COUNT(HeapPops, 1);
+            }
+        };
+        auto recheckNode = [&](Index i) {
+            if (st.nodeActive[i] && st.nodeLoads[i] >= nodeCapacity[i]) {
+                if (!pending.contains(i)) pendingNodes++;
+                pending.push(i, st.nodeLoads[i] / nodeCapacity[i]);
+                GRID_COUNT(HeapPushes, 1);
+            }
+        };
+        vector<Index>& touched = scratch.touched;
+        auto failLine = [&](Index id, bool forced) {
+            st.setLineActive(id, false);
+            recheckLine(id);
+            result.events.push_back({-1, id, st.lineLoads[id], lineCapacity[id], forced});
+            if (observer) observer->onFailure(result.events.back());
+            if (dc) {
+                dc->outage(id, st, touched, observer);
+            } else {
+                redistributeLoad(st, id, &touched, observer);
+            }
+            for (Index t : touched) {
+                result.linePeakLoading[t] = max(result.linePeakLoading[t], static_cast<double>(st.lineLoads[t]) / lineCapacity[t]);
+                recheckLine(t);
+            }
+        };
+        // Pass a failed node's demand to its live neighbours in proportion to
+        // their spare capacity, then trip its lines; their flows go with it
+        // unless DC flow moves them
+        vector<Index>& tripped = scratch.tripped;
+        auto tripNode = [&](Index i, bool forced) {
+            double demand = st.nodeLoads[i], spare = 0.0;
+            tripped.clear();
+            for (Index k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                const Adjacent& a = adjacency[k];
+                if (!st.lineActive[a.line]) continue;
+                tripped.push_back(a.line);
+                if (st.nodeActive[a.to] && st.nodeLoads[a.to] < nodeCapacity[a.to]) {
+                    spare += nodeCapacity[a.to] - st.nodeLoads[a.to];
+                }
+            }
+            if (spare > 0) {
+                double demandPerCapacity = demand / spare;
+                for (Index id : tripped) {
+                    Index j = lines[id].from == i ? lines[id].to : lines[id].from;
+                    if (!st.nodeActive[j] || st.nodeLoads[j] >= nodeCapacity[j]) continue;
+                    double amount = demandPerCapacity * (nodeCapacity[j] - st.nodeLoads[j]);
+                    st.setNodeLoad(j, st.nodeLoads[j] + amount);
+                    if (observer) observer->onDemandTransfer(i, j, amount);
+                    result.nodePeakLoading[j] = max(result.nodePeakLoading[j], static_cast<double>(st.nodeLoads[j]) / nodeCapacity[j]);
+                    recheckNode(j);
+                }
+                result.transferredDemand += demand;
+            } else {
+                result.droppedDemand += demand;
+                if (observer) observer->onDemandTransfer(i, -1, demand);
+            }
+            st.setNodeLoad(i, 0.0);
+            for (Index id : tripped) {
+                if (dc) {
+                    failLine(id, forced);
+                    continue;
+                }
+                st.setLineActive(id, false);
+                recheckLine(id);
+                result.events.push_back({-1, id, st.lineLoads[id], lineCapacity[id], forced});
+                if (observer) observer->onFailure(result.events.back());
+            }
+        };
+        auto failNode = [&](Index i, bool forced) {
+            st.setNodeActive(i, false);
+            if (pending.contains(i)) {
+                pending.remove(i);
+                pendingNodes--;
+                GRID_COUNT(HeapPops, 1);
+            }
+            result.events.push_back({i, -1, st.nodeLoads[i], nodeCapacity[i], forced});
+            if (observer) observer->onFailure(result.events.back());
+            if (options.balanceIslands) tripNode(i, forced);
+        };
+
+        // Initial full scan
+        vector<Index>& overloadedNodes = scratch.overloadedNodes;
+        vector<Index>& overloadedLines = scratch.overloadedLines;
+        checkOverloads(st, overloadedNodes, overloadedLines);
+        for (Index i : overloadedNodes) pending.push(i, st.nodeLoads[i] / nodeCapacity[i]);
+        for (Index id : overloadedLines) pending.push(numNodes + id, st.lineLoads[id] / lineCapacity[id]);
+        pendingNodes = overloadedNodes.size();
+        pendingLines = overloadedLines.size();
+        GRID_COUNT(HeapPushes, pendingNodes + pendingLines);
+
+        // Force contingency elements out of service
+        for (Index i : options.outages.nodes) {
+            if (i >= 0 && i < numNodes && st.nodeActive[i]) failNode(i, true);
+        }
+        for (Index id : options.outages.lines) {
+            if (id >= 0 && id < static_cast<Index>(lines.size()) && st.lineActive[id]) failLine(id, true);
+        }
+
+        if (options.rounds) {
+            // Everything pending at the start of a round fails together, in
+            // index order. Its redistributions all see the loads of the round's
+            // start, with the whole round out of service, and are added in the
+            // order of the failed lines, so the result is the same on any pool.
+            vector<Index>& round = scratch.round;
+            vector<vector<LoadShare>>& roundShares = scratch.roundShares;
+            bool initial = true;
+            while (!pending.empty()) {
+                if (observer) observer->onOverloadCheck(pendingNodes, pendingLines, initial);
+                initial = false;
+                round.clear();
+                while (!pending.empty()) round.push_back(pending.pop());
+                GRID_COUNT(HeapPops, round.size());
+                GRID_COUNT(CascadeSteps, round.size());
+                sort(round.begin(), round.end());
+                pendingNodes = pendingLines = 0;
+                result.rounds++;
+                size_t firstLine = lower_bound(round.begin(), round.end(), numNodes) - round.begin();
+                for (size_t k = 0; k < firstLine; k++) failNode(round[k], false);
+                // Lines already tripped by this round's failed nodes
+                round.erase(remove_if(round.begin() + firstLine, round.end(),
+                                      [&](Index key) { return !st.lineActive[key - numNodes]; }),
+                            round.end());
+                if (dc) {
+                    // Outages of a set of lines give the same flows in any order
+                    for (size_t k = firstLine; k < round.size(); k++) failLine(round[k] - numNodes, false);
+                } else {
+                    for (size_t k = firstLine; k < round.size(); k++) {
+                        Index id = round[k] - numNodes;
+                        st.setLineActive(id, false);
+                        result.events.push_back({-1, id, st.lineLoads[id], lineCapacity[id], false});
+                        if (observer) observer->onFailure(result.events.back());
+                    }
+                    size_t count = round.size() - firstLine;
+                    roundShares.resize(max(roundShares.size(), count));
+                    auto share = [&](unsigned, size_t k) {
+                        redistributionShares(st, round[firstLine + k] - numNodes, roundShares[k]);
+                    };
+                    if (options.pool && count >= parallelRoundLines) {
+                        options.pool->parallelFor(count, share);
+                    } else {
+                        for (size_t k = 0; k < count; k++) share(0, k);
+                    }
+                    touched.clear();
+                    for (size_t k = 0; k < count; k++) {
+                        for (const LoadShare& sh : roundShares[k]) {
+                            if (sh.line < 0) {
+                                if (observer) observer->onNoSpareCapacity(sh.node);
+                                continue;
+                            }
+                            st.setLineLoad(sh.line, st.lineLoads[sh.line] + sh.load);
+                            touched.push_back(sh.line);
+                            if (observer) observer->onRedistribute(sh.node, sh.line, sh.load);
+                        }
+                    }
+                    for (Index t : touched) {
+                        result.linePeakLoading[t] = max(result.linePeakLoading[t], static_cast<double>(st.lineLoads[t]) / lineCapacity[t]);
+                        recheckLine(t);
+                    }
+                }
+                if (options.stopWhen && options.stopWhen(result)) break;
+            }
+        } else {
+            // Process failures, least severe overload first
+            if (observer) observer->onOverloadCheck(pendingNodes, pendingLines, true);
+            while (!pending.empty()) {
+                Index key = pending.pop();
+                GRID_COUNT(HeapPops, 1);
+                GRID_COUNT(CascadeSteps, 1);
+                if (key < numNodes) {
+                    pendingNodes--;
+                    failNode(key, false);
+                } else {
+                    pendingLines--;
+                    failLine(key - numNodes, false);
+                }
+                if (observer) observer->onOverloadCheck(pendingNodes, pendingLines, false);
+                if (options.stopWhen && options.stopWhen(result)) break;
+            }
+        }
+
+        // Record final state
+        result.nodeActive.resize(numNodes);
+        for (Index i = 0; i < numNodes; i++) result.nodeActive[i] = st.nodeActive[i];
+        result.lineActive.resize(lines.size());
+        for (size_t id = 0; id < lines.size(); id++) result.lineActive[id] = st.lineActive[id];
+        findComponents(st, result.islands, options.pool);
+        if (options.balanceIslands) balanceIslands(st, result, options.pool, observer);
+        if (options.islandTimeline) {
+            buildIslandTimeline(result, scratch);
+        } else {
+            result.timeline.clear();
+            result.initialIslands = 0;
+        }
+        if (observer) observer->onFinish(result);
+    }
+
+    // Balance each island of a finished cascade on its own generation, a
+    // self-supplied node generating its current load. An
+    // island short of generation trips shedding stages until it is not, each
+    // shedding a fixed share of its demand from every node and line in it;
+    // one without generation, or still short after the last stage, blacks
+    // out. Shedding only lowers loads, so nothing fails after it. Islands
+    // share no elements, so many of them are balanced in parallel; the
+    // observer then hears of each island that shed, in island order.
+    void balanceIslands(GridState& st, CascadeResult& result, WorkStealingPool* pool = nullptr,
+                        CascadeObserver* observer = nullptr) const {
+        GRID_TIME(BalancePhase);
+        const ComponentLabels& cc = result.islands;
+        GRID_COUNT(IslandsBalanced, cc.count());
+        result.balance.assign(cc.count(), IslandBalance());
+        st.saveLoads();
+        auto balance = [&](unsigned, size_t c) {
+            IslandBalance& b = result.balance[c];
+            for (Index k = cc.offsets[c]; k < cc.offsets[c + 1]; k++) {
+                Index u = cc.members[k];
+                b.generation += nodeGeneration[u] < 0 ? st.nodeLoads[u] : nodeGeneration[u];
+                b.demand += st.nodeLoads[u];
+            }
+            double deficit = b.demand - b.generation;
+            if (deficit <= 0) return;
+            if (b.generation <= 0) {
+                b.blackout = true;
+            } else {
+                // The small allowance keeps an exact multiple of a stage from rounding up
+                b.stages = static_cast<int>(ceil(deficit / (b.demand * uflsStageShare) - 1e-9));
+                if (b.stages > uflsStages) {
+                    b.stages = uflsStages;
+                    b.blackout = true;
+                }
+            }
+            double keep = keptShare(b);
+            b.shed = b.demand * (1.0 - keep);
+            shedIsland(st, cc, c, keep);
+        };
+        if (pool && cc.count() >= parallelIslands) {
+            pool->parallelFor(cc.count(), balance);
+        } else {
+            for (size_t c = 0; c < cc.count(); c++) balance(0, c);
+        }
+        if (observer) {
+            for (size_t c = 0; c < cc.count(); c++) {
+                const IslandBalance& b = result.balance[c];
+                if (b.blackout || b.stages > 0) observer->onShed(cc.members[cc.offsets[c]], keptShare(b));
+            }
+        }
+    }
+
+    // Share of its loads an island keeps after its shedding stages
+    static double keptShare(const IslandBalance& b) { return b.blackout ? 0.0 : 1.0 - b.stages * uflsStageShare; }
+
+    // Scale the loads of island c of cc, its nodes and the active lines inside
+    // it, by keep. Written directly, so a checkpoint needs saveLoads first.
+    void shedIsland(GridState& st, const ComponentLabels& cc, size_t c, double keep) const {
+        for (Index k = cc.offsets[c]; k < cc.offsets[c + 1]; k++) {
+            Index u = cc.members[k];
+            st.nodeLoads[u] *= keep;
+            for (Index j = rowStart[u]; j < rowStart[u + 1]; j++) {
+                const Adjacent& a = adjacency[j];
+                if (u < a.to && st.lineActive[a.line] && cc.label[a.to] == static_cast<Index>(c)) st.lineLoads[a.line] *= keep;
+            }
+        }
+    }
+
+    // Fill in the island timeline of a finished cascade. Failures are replayed
+    // backwards from the final state as unions, so the whole timeline costs
+    // near-linear time instead of a connectivity pass per failure.
+    void buildIslandTimeline(CascadeResult& result, CascadeScratch& scratch) const {
+        BasicUnionFind<Index>& uf = scratch.uf;
+        uf.reset(numNodes);
+        vector<char>& nodeOn = scratch.nodeOn;
+        vector<char>& lineOn = scratch.lineOn;
+        nodeOn.assign(result.nodeActive.begin(), result.nodeActive.end());
+        lineOn.assign(result.lineActive.begin(), result.lineActive.end());
+        Index islands = 0, largest = 0;
+        for (Index i = 0; i < numNodes; i++) islands += nodeOn[i];
+        if (islands > 0) largest = 1;
+        auto join = [&](Index u, Index v) {
+            if (uf.unite(u, v)) {
+                islands--;
+                largest = max(largest, uf.setSize(u));
+            }
+        };
+        for (Index id = 0; id < static_cast<Index>(lines.size()); id++) {
+            if (lineOn[id] && nodeOn[lines[id].from] && nodeOn[lines[id].to]) join(lines[id].from, lines[id].to);
+        }
+
+        // Steps are overwritten rather than replaced, so their pieces keep their storage
+        result.timeline.resize(result.events.size());
+        vector<Index>& roots = scratch.roots;
+        for (size_t k = result.events.size(); k-- > 0;) {
+            const FailureEvent& ev = result.events[k];
+            IslandStep& step = result.timeline[k];
+            step.islands = islands;
+            step.largest = largest;
+            step.pieces.clear();
+
+            // Undo the failure; the islands it reconnects are the ones it split
+            roots.clear();
+            if (ev.line == -1) {
+                Index v = ev.node;
+                nodeOn[v] = true;
+                islands++;
+                largest = max<Index>(largest, 1);
+                for (Index j = rowStart[v]; j < rowStart[v + 1]; j++) {
+                    const Adjacent& a = adjacency[j];
+                    if (lineOn[a.line] && nodeOn[a.to]) roots.push_back(uf.find(a.to));
+                }
+                sort(roots.begin(), roots.end());
+                roots.erase(unique(roots.begin(), roots.end()), roots.end());
+                if (roots.size() >= 2) {
+                    for (Index r : roots) step.pieces.push_back(uf.setSize(r));
+                }
+                for (Index r : roots) join(v, r);
+            } else {
+                const Line& l = lines[ev.line];
+                lineOn[ev.line] = true;
+                if (nodeOn[l.from] && nodeOn[l.to] && uf.find(l.from) != uf.find(l.to)) {
+                    step.pieces = {uf.setSize(l.from), uf.setSize(l.to)};
+                    join(l.from, l.to);
+                }
+            }
+            sort(step.pieces.rbegin(), step.pieces.rend());
+        }
+        result.initialIslands = islands;
+    }
+
+    // Run a cascade on the grid's own state, which is rolled back before returning
+    CascadeResult runCascade(const CascadeOptions& options, CascadeObserver* observer = nullptr) {
+        state.checkpoint();
+        CascadeResult result = runCascade(state, options, observer);
+        state.rollback();
+        return result;
+    }
+
+    // Run many randomized cascades in parallel. Trial t uses random stream
+    // (seed, t), so results do not depend on the thread count; per-element
+    // statistics are accumulated per worker and merged at the end. Each
+    // worker reuses its state, cascade scratch and result for every trial.
+    MonteCarloSummary runMonteCarlo(const CascadeOptions& options, int trials, WorkStealingPool* pool = nullptr) const {
+        ensureTopology();
+        if (options.dcFlow) ensureDcFactor();
+        Index m = static_cast<Index>(lines.size());
+        unsigned workers = pool ? pool->size() : 1;
+        vector<MonteCarloSummary> partial(workers);
+        vector<GridState> scratch(workers, state);
+        vector<CascadeScratch> cascadeScratch(workers);
+        vector<CascadeResult> results(workers);
+        CascadeOptions base = options;
+        base.islandTimeline = false;
+        base.pool = nullptr; // The trials are themselves pool tasks
+        vector<CascadeOptions> trialOptions(workers, base);
+        for (MonteCarloSummary& p : partial) {
+            p.nodes.assign(numNodes, ElementStats());
+            p.lines.assign(m, ElementStats());
+        }
+        auto trial = [&](unsigned w, size_t t) {
+            GridState& st = scratch[w];
+            CascadeOptions& opt = trialOptions[w];
+            CascadeResult& r = results[w];
+            opt.trial = t;
+            st.checkpoint();
+            runCascade(st, opt, cascadeScratch[w], r);
+            st.rollback();
+            MonteCarloSummary& acc = partial[w];
+            uint64_t size = r.events.size();
+            acc.trials++;
+            acc.totalFailures += size;
+            if (r.islands.count() > 1) acc.islandedTrials++;
+            bool shed = false, blackout = false;
+            for (const IslandBalance& b : r.balance) {
+                shed = shed || b.shed > 0;
+                blackout = blackout || b.blackout;
+            }
+            acc.sheddingTrials += shed;
+            acc.blackoutTrials += blackout;
+
+            // Islanded = active but outside the largest island; a line is
+            // active and both of its ends lie in the same smaller island
+            const vector<Index>& island = r.islands.label;
+            size_t largest = 0;
+            for (size_t c = 1; c < r.islands.count(); c++) {
+                if (r.islands.size(c) > r.islands.size(largest)) largest = c;
+            }
+            for (const FailureEvent& ev : r.events) {
+                ElementStats& es = ev.line == -1 ? acc.nodes[ev.node] : acc.lines[ev.line];
+                es.failures++;
+                es.cascadeSizeSum += size;
+            }
+            for (Index v = 0; v < numNodes; v++) {
+                if (island[v] != -1 && island[v] != static_cast<Index>(largest)) acc.nodes[v].islanded++;
+            }
+            for (Index id = 0; id < m; id++) {
+                Index c = island[lines[id].from];
+                if (r.lineActive[id] && c != -1 && c == island[lines[id].to] && c != static_cast<Index>(largest)) acc.lines[id].islanded++;
+            }
+        };
+        if (pool && workers > 1) {
+            pool->parallelFor(trials, trial);
+        } else {
+            for (int t = 0; t < trials; t++) trial(0, t);
+        }
+
+        // Merge in worker order; all sums are integers, so the result is exact
+        MonteCarloSummary total = partial[0];
+        for (unsigned w = 1; w < workers; w++) {
+            total.trials += partial[w].trials;
+            total.totalFailures += partial[w].totalFailures;
+            total.islandedTrials += partial[w].islandedTrials;
+            total.sheddingTrials += partial[w].sheddingTrials;
+            total.blackoutTrials += partial[w].blackoutTrials;
+            for (Index v = 0; v < numNodes; v++) total.nodes[v] += partial[w].nodes[v];
+            for (Index id = 0; id < m; id++) total.lines[id] += partial[w].lines[id];
+        }
+        return total;
+    }
+
+
+    // Build the cached topology (and DC factor) now, so that const methods
+    // can then run concurrently
+    void prepare(bool dcFlow) const {
+        ensureTopology();
+        if (dcFlow) ensureDcFactor();
+    }
+
+    // Find the smallest load increase, up to options.loadIncreasePercent, at
+    // which the cascade on st (a) fails any element, (b) splits the grid into
+    // more islands, or (c) loses lossFraction of the active nodes to failure or
+    // to islands cut off from the largest one. Outcomes are assumed monotone
+    // in the increase and each is bisected to marginTolerance. Probes run from
+    // a checkpoint on st and stop once their own outcome is decided; a probe
+    // that runs to the end narrows the brackets of all three searches. Without
+    // forced outages the first failure is found analytically.
+    MarginResult findMargin(GridState& st, const CascadeOptions& options, double lossFraction) const {
+        ensureTopology();
+        MarginResult margin;
+        const double limit = options.loadIncreasePercent;
+        const size_t baseIslands = findComponents(st).count();
+        const Index activeNodes = static_cast<Index>(st.nodeActive.countSet());
+        const Index lossNodes = max<Index>(1, static_cast<Index>(ceil(lossFraction * activeNodes)));
+
+        // Outcome of each criterion at each probed increase: 1, 0 or -1 (undecided)
+        enum { Failure, Islanding, NodeLoss };
+        struct Probe {
+            double percent;
+            int outcome[3];
+        };
+        vector<Probe> probes;
+        // Shared by every probe, so that only the first one allocates
+        CascadeOptions opt = options;
+        opt.islandTimeline = false;
+        opt.pool = nullptr; // A margin search may itself be a pool task
+        CascadeScratch scratch;
+        CascadeResult r;
+        int probed = Failure; // Criterion of the running probe
+        bool stopped = false;
+        size_t counted = 0;
+        Index failedNodes = 0;
+        opt.stopWhen = [&](const CascadeResult& partial) {
+            for (; counted < partial.events.size(); counted++) failedNodes += partial.events[counted].line == -1;
+            stopped = probed == Failure || (probed == NodeLoss && failedNodes >= lossNodes);
+            return stopped;
+        };
+        auto probe = [&](double percent, int criterion) {
+            opt.loadIncreasePercent = percent;
+            probed = criterion;
+            stopped = false;
+            counted = 0;
+            failedNodes = 0;
+            st.checkpoint();
+            runCascade(st, opt, scratch, r);
+            st.rollback();
+            margin.cascades++;
+            Probe p = {percent, {0, -1, -1}};
+            for (const FailureEvent& ev : r.events) p.outcome[Failure] |= !ev.forced;
+            if (!stopped) {
+                Index largest = 0;
+                for (size_t c = 0; c < r.islands.count(); c++) largest = max(largest, r.islands.size(c));
+                p.outcome[Islanding] = r.islands.count() > baseIslands;
+                p.outcome[NodeLoss] = activeNodes - largest >= lossNodes;
+            } else if (criterion == NodeLoss) {
+                p.outcome[NodeLoss] = 1;
+            }
+            probes.push_back(p);
+        };
+
+        // Smallest increase known to cause the outcome, and the largest below it known not to
+        auto bracket = [&](int criterion, double& lo, double& hi) {
+            hi = lo = -1;
+            for (const Probe& p : probes) {
+                if (p.outcome[criterion] == 1 && (hi < 0 || p.percent < hi)) hi = p.percent;
+            }
+            for (const Probe& p : probes) {
+                if (p.outcome[criterion] == 0 && (hi < 0 || p.percent < hi)) lo = max(lo, p.percent);
+            }
+        };
+        auto search = [&](int criterion) {
+            double lo, hi;
+            bracket(criterion, lo, hi);
+            if (hi < 0) {
+                probe(limit, criterion);
+                bracket(criterion, lo, hi);
+                if (hi < 0) return -1.0;
+            }
+            if (lo < 0 && hi > 0) {
+                probe(0.0, criterion);
+                bracket(criterion, lo, hi);
+            }
+            if (lo < 0) return hi;
+            while (hi - lo > marginTolerance) {
+                probe((lo + hi) / 2, criterion);
+                bracket(criterion, lo, hi);
+            }
+            return hi;
+        };
+
+        if (options.outages.nodes.empty() && options.outages.lines.empty()) {
+            // Nothing fails below the first overload, so two probes pin it down
+            double first = firstOverloadPercent(st, options);
+            if (first <= limit) {
+                probe(first, Failure);
+                if (probes.back().outcome[Failure] == 0) probe(min(limit, first + marginTolerance), Failure);
+                else if (first > 0) probe(max(0.0, first - marginTolerance), Failure);
+            }
+        }
+        margin.firstFailure = search(Failure);
+        margin.islanding = search(Islanding);
+        margin.nodeLoss = search(NodeLoss);
+        return margin;
+    }
+
+    // Simulate cascading failures, printing every step
+    void simulateCascadingFailures(double loadIncreasePercent, bool randomLoad);
+
+    // Redistribute the load of a failed line over spare capacity at both ends;
+    // lines that received load are listed in touched if given
+    void redistributeLoad(GridState& st, Index failedLine, vector<Index>* touched = nullptr,
+                          CascadeObserver* observer = nullptr) const {
+        GRID_TIME_SAMPLED(RedistributionPhase);
+        GRID_COUNT(Redistributions, 1);
+        ensureTopology();
+        if (touched) touched->clear();
+        double failedLoad = st.lineLoads[failedLine];
+        for (Index i : {lines[failedLine].from, lines[failedLine].to}) {
+            double totalCapacity = 0.0;
+            for (Index k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                Index id = adjacency[k].line;
+                if (st.lineActive[id] && st.nodeActive[adjacency[k].to] && st.lineLoads[id] < lineCapacity[id]) {
+                    totalCapacity += lineCapacity[id] - st.lineLoads[id];
+                }
+            }
+            if (totalCapacity <= 0) {
+                if (observer) observer->onNoSpareCapacity(i);
+                continue;
+            }
+            double loadPerCapacity = failedLoad / totalCapacity;
+            for (Index k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                Index id = adjacency[k].line;
+                if (st.lineActive[id] && st.nodeActive[adjacency[k].to] && st.lineLoads[id] < lineCapacity[id]) {
+                    double additionalLoad = loadPerCapacity * (lineCapacity[id] - st.lineLoads[id]);
+                    st.setLineLoad(id, st.lineLoads[id] + additionalLoad);
+                    if (touched) touched->push_back(id);
+                    if (observer) observer->onRedistribute(i, id, additionalLoad);
+                }
+            }
+        }
+    }
+
+    // The load a failed line passes to each line at its ends, as redistributeLoad
+    // would add it, without changing st; a share with line -1 marks an end
+    // with no spare capacity
+    void redistributionShares(const GridState& st, Index failedLine, vector<LoadShare>& shares) const {
+        GRID_TIME_SAMPLED(RedistributionPhase);
+        GRID_COUNT(Redistributions, 1);
+        shares.clear();
+        double failedLoad = st.lineLoads[failedLine];
+        for (Index i : {lines[failedLine].from, lines[failedLine].to}) {
+            double totalCapacity = 0.0;
+            for (Index k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                Index id = adjacency[k].line;
+                if (st.lineActive[id] && st.nodeActive[adjacency[k].to] && st.lineLoads[id] < lineCapacity[id]) {
+                    totalCapacity += lineCapacity[id] - st.lineLoads[id];
+                }
+            }
+            if (totalCapacity <= 0) {
+                shares.push_back({i, -1, 0.0});
+                continue;
+            }
+            double loadPerCapacity = failedLoad / totalCapacity;
+            for (Index k = rowStart[i]; k < rowStart[i + 1]; k++) {
+                Index id = adjacency[k].line;
+                if (st.lineActive[id] && st.nodeActive[adjacency[k].to] && st.lineLoads[id] < lineCapacity[id]) {
+                    shares.push_back({i, id, loadPerCapacity * (lineCapacity[id] - st.lineLoads[id])});
+                }
+            }
+        }
+    }
+
+    // Find articulation points and bridges of the active grid in one iterative
+    // Hopcroft-Tarjan pass over the CSR adjacency, O(N + E)
+    CutAnalysis findCutElements(const GridState& st) const {
+        ensureTopology();
+        CutAnalysis cut;
+        cut.pieces.assign(numNodes, 0);
+        cut.bridge.assign(lines.size(), false);
+        vector<Index> disc(numNodes, -1), low(numNodes, 0), next(numNodes, 0), parent(numNodes, -1), parentLine(numNodes, -1);
+        vector<Index> stack;
+        Index timer = 0;
+        for (Index root = 0; root < numNodes; root++) {
+            if (!st.nodeActive[root] || disc[root] != -1) continue;
+            cut.components++;
+            disc[root] = low[root] = timer++;
+            next[root] = rowStart[root];
+            stack.push_back(root);
+            while (!stack.empty()) {
+                Index v = stack.back();
+                if (next[v] < rowStart[v + 1]) {
+                    const Adjacent& a = adjacency[next[v]++];
+                    if (!st.lineActive[a.line] || !st.nodeActive[a.to] || a.line == parentLine[v]) continue;
+                    if (disc[a.to] == -1) {
+                        disc[a.to] = low[a.to] = timer++;
+                        next[a.to] = rowStart[a.to];
+                        parent[a.to] = v;
+                        parentLine[a.to] = a.line;
+                        stack.push_back(a.to);
+                    } else {
+                        low[v] = min(low[v], disc[a.to]);
+                    }
+                    continue;
+                }
+                stack.pop_back();
+                Index p = parent[v];
+                if (p == -1) continue;
+                low[p] = min(low[p], low[v]);
+                if (low[v] > disc[p]) cut.bridge[parentLine[v]] = true;
+                if (low[v] >= disc[p]) cut.pieces[p]++; // Subtree of v is cut off without p
+            }
+        }
+        for (Index i = 0; i < numNodes; i++) {
+            if (st.nodeActive[i] && parent[i] != -1) cut.pieces[i]++; // The side containing the parent
+        }
+        return cut;
+    }
+
+    // Check whether losing one line overloads a neighbour, working on a
+    // private scratch copy of the state that is rolled back from its journal
+    bool outageOverloads(Index id, ContingencyScratch& scratch) const {
+        GridState& st = scratch.state;
+        st.checkpoint();
+        st.setLineActive(id, false);
+        redistributeLoad(st, id, &scratch.touched);
+        bool overloads = false;
+        for (Index t : scratch.touched) overloads = overloads || st.lineLoads[t] >= lineCapacity[t];
+        st.rollback();
+        return overloads;
+    }
+
+    // Find critical nodes and edges without printing anything. Line outages
+    // are screened on the pool if given, each worker using its own scratch
+    // state; the report is in line ID order regardless of scheduling.
+    CriticalReport analyzeCriticalComponents(WorkStealingPool* pool = nullptr) const {
+        ensureTopology();
+        CriticalReport report;
+        CutAnalysis cut = findCutElements(state);
+
+        // A node is critical if more than one island remains without it
+        for (Index i = 0; i < numNodes; i++) {
+            if (state.nodeActive[i] && cut.components - 1 + cut.pieces[i] > 1) report.nodes.push_back(i);
+        }
+
+        // Overloads present before any outage make every non-disconnecting outage critical
+        vector<Index> overloadedNodes, overloadedLines;
+        checkOverloads(overloadedNodes, overloadedLines);
+
+        // Only lines whose outage keeps the grid connected need the
+        // redistribution check, and that only touches their two endpoints
+        Index m = static_cast<Index>(lines.size());
+        vector<char> verdict(m, 0); // 0 = not critical, 1 = overloads, 2 = disconnects
+        vector<Index> toScreen;
+        for (Index id = 0; id < m; id++) {
+            if (!state.lineActive[id]) continue;
+            bool selfOverloaded = state.lineLoads[id] >= lineCapacity[id];
+            if (cut.components + (cut.bridge[id] ? 1 : 0) > 1) {
+                verdict[id] = 2;
+            } else if (!overloadedNodes.empty() || overloadedLines.size() > (selfOverloaded ? 1u : 0u)) {
+                verdict[id] = 1;
+            } else {
+                toScreen.push_back(id);
+            }
+        }
+        if (pool && pool->size() > 1 && !toScreen.empty()) {
+            vector<ContingencyScratch> scratch(pool->size());
+            pool->parallelFor(toScreen.size(), [&](unsigned worker, size_t k) {
+                ContingencyScratch& sc = scratch[worker];
+                if (sc.state.lineLoads.empty()) sc.state = state; // First task on this worker
+                if (outageOverloads(toScreen[k], sc)) verdict[toScreen[k]] = 1;
+            });
+        } else if (!toScreen.empty()) {
+            ContingencyScratch sc;
+            sc.state = state;
+            for (Index id : toScreen) {
+                if (outageOverloads(id, sc)) verdict[id] = 1;
+            }
+        }
+        for (Index id = 0; id < m; id++) {
+            if (verdict[id]) report.lines.push_back({id, verdict[id] == 2});
+        }
+        return report;
+    }
+
+    // Identify critical nodes and edges
+    void identifyCriticalComponents(WorkStealingPool* pool = nullptr) const {
+        CriticalReport report = analyzeCriticalComponents(pool);
+        cout << "\nCritical Component Analysis:\n";
+        cout << "Critical Nodes (failure disconnects grid):\n";
+        for (Index i : report.nodes) {
+            cout << "- " << nodeNames[i] << ": Failure disconnects grid\n";
+        }
+        cout << "Critical Edges (failure causes overloads or disconnection):\n";
+        for (const CriticalLine& c : report.lines) {
+            cout << "- Edge " << nodeNames[lines[c.line].from] << "-" << nodeNames[lines[c.line].to]
+                 << ": Failure causes " << (c.disconnects ? "disconnection" : "overloads") << "\n";
+        }
+    }
+
+    // Report the status and islands of st
+    void reportGridState(const GridState& st, ostream& out = cout) const {
+        out << "\nFinal Grid State:\n";
+        Index activeNodes = 0, activeEdges = 0;
+        activeNodes += st.nodeActive.countSet();
+        activeEdges += st.lineActive.countSet();
+        out << "Active Nodes: " << activeNodes << "/" << numNodes << "\n";
+        out << "Active Edges: " << activeEdges << "\n";
+        ComponentLabels components = findComponents(st, numNodes >= parallelLabelNodes ? &defaultPool() : nullptr);
+        if (components.count() > 1) {
+            out << "Grid is disconnected! Number of components: " << components.count() << "\n";
+            for (size_t c = 0; c < components.count(); c++) {
+                out << "Component " << c + 1 << ": ";
+                for (Index k = components.offsets[c]; k < components.offsets[c + 1]; k++) {
+                    out << nodeNames[components.members[k]] << " ";
+                }
+                out << "\n";
+            }
+        } else {
+            out << "Grid remains connected.\n";
+        }
+    }
+
+    void reportGridState() const { reportGridState(state); }
+
+    // Display grid status
+    void displayGrid() const {
+        ensureTopology();
+        cout << "\nGrid Status:\n";
+        cout << "Nodes (Substations):\n";
+        for (Index i = 0; i < numNodes; i++) {
+            cout << "Node " << nodeNames[i] << ": Load = " << fixed << setprecision(2)
+                 << state.nodeLoads[i] << " MW, Max Capacity = " << nodeCapacity[i]
+                 << " MW, Status = " << (state.nodeActive[i] ? "Active" : "Failed") << "\n";
+        }
+        cout << "Edges (Transmission Lines):\n";
+        for (Index u = 0; u < numNodes; u++) {
+            for (Index k = rowStart[u]; k < rowStart[u + 1]; k++) {
+                const Adjacent& a = adjacency[k];
+                if (u < a.to) {
+                    cout << "Between " << nodeNames[u] << " and " << nodeNames[a.to]
+                         << ": Load = " << state.lineLoads[a.line] << " MW, Capacity = " << lineCapacity[a.line]
+                         << " MW, Status = " << (state.lineActive[a.line] ? "Active" : "Failed") << "\n";
+                }
+            }
+        }
+    }
+
+    // Write st as a Graphviz graph; failed elements are drawn red
+    void writeDot(ostream& out, const GridState& st) const {
+        ensureTopology();
+        out << "graph G {\n";
+        out << "    rankdir=LR;\n";
+        for (Index i = 0; i < numNodes; i++) {
+            out << "    " << nodeNames[i] << " [label=\"" << nodeNames[i] << "\\nLoad: "
+                << fixed << setprecision(2) << st.nodeLoads[i] << " MW\\nCap: " << nodeCapacity[i]
+                << " MW\", color=" << (st.nodeActive[i] ? "blue" : "red") << "];\n";
+        }
+        for (Index u = 0; u < numNodes; u++) {
+            for (Index k = rowStart[u]; k < rowStart[u + 1]; k++) {
+                const Adjacent& a = adjacency[k];
+                if (u < a.to) {
+                    out << "    " << nodeNames[u] << " -- " << nodeNames[a.to]
+                        << " [label=\"Load: " << st.lineLoads[a.line] << " MW\\nCap: " << lineCapacity[a.line]
+                        << " MW\", color=" << (st.lineActive[a.line] ? "black" : "red") << "];\n";
+                }
+            }
+        }
+        out << "}\n";
+    }
+
+    // Save grid visualization to DOT file
+    void saveGridVisualization(const string& filename) const {
+        ofstream out(filename);
+        if (!out) {
+            *messages << "Error opening file: " << filename << "\n";
+            return;
+        }
+        writeDot(out, state);
+        out.close();
+        *messages << "Grid visualization saved to " << filename << "\n";
+    }
+
+    // Save grid to file
+    bool saveGrid(const string& filename) const {
+        ensureTopology();
+        ofstream out(filename);
+        if (!out) {
+            *messages << "Error opening file: " << filename << "\n";
+            return false;
+        }
+        // Generation is only written for nodes that do not supply their own load
+        out << numNodes << "\n";
+        for (Index i = 0; i < numNodes; i++) {
+            out << nodeNames[i] << " " << formatNumber(state.nodeLoads[i]) << " " << formatNumber(nodeCapacity[i]);
+            if (nodeGeneration[i] >= 0) out << " " << formatNumber(nodeGeneration[i]);
+            out << "\n";
+        }
+        out << lines.size() << "\n";
+        for (Index u = 0; u < numNodes; u++) {
+            for (Index k = rowStart[u]; k < rowStart[u + 1]; k++) {
+                const Adjacent& a = adjacency[k];
+                if (u < a.to) {
+                    out << u << " " << a.to << " " << formatNumber(state.lineLoads[a.line])
+                        << " " << formatNumber(lineCapacity[a.line]);
+                    if (lines[a.line].reactance != 1.0) out << " " << formatNumber(lines[a.line].reactance);
+                    out << "\n";
+                }
+            }
+        }
+        GRID_COUNT(BytesWritten, static_cast<uint64_t>(out.tellp()));
+        out.close();
+        if (verbose) *messages << "Grid saved to " << filename << "\n";
+        return true;
+    }
+
+    // Write a binary snapshot of the grid, its state and its topology
+    bool saveSnapshot(const string& filename) const {
+        ensureTopology();
+        uint64_t m = lines.size();
+        if (static_cast<uint64_t>(numNodes) > static_cast<uint64_t>(numeric_limits<int>::max())
+            || m > static_cast<uint64_t>(numeric_limits<int>::max() / 2)) {
+            *messages << "Grid is too large for a snapshot: " << filename << "\n";
+            return false;
+        }
+
+        // Intern the names so repeated names are stored once
+        map<string, uint32_t> interned;
+        string table;
+        vector<NameRef> refs(numNodes);
+        for (Index i = 0; i < numNodes; i++) {
+            auto it = interned.emplace(nodeNames[i], static_cast<uint32_t>(table.size())).first;
+            if (it->second == table.size()) table += nodeNames[i];
+            refs[i] = {it->second, static_cast<uint32_t>(nodeNames[i].size())};
+        }
+
+        SnapshotLayout layout(numNodes, m, table.size());
+        vector<char> image(layout.end, 0);
+        vector<char> nodeStatus = state.nodeActive.toBytes(), lineStatus = state.lineActive.toBytes();
+        // Sections always hold doubles and 32-bit indices; other engine types
+        // are converted record by record
+        auto put = [&](uint64_t offset, const auto* data, size_t count, auto stored) {
+            using Stored = decltype(stored);
+            if constexpr (is_same<remove_const_t<remove_pointer_t<decltype(data)>>, Stored>::value) {
+                if (count) memcpy(image.data() + offset, data, count * sizeof(Stored));
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    Stored record = data[i];
+                    memcpy(image.data() + offset + i * sizeof(Stored), &record, sizeof(Stored));
+                }
+            }
+        };
+        put(layout.nodeCapacity, nodeCapacity.data(), numNodes, double());
+        put(layout.nodeLoad, state.nodeLoads.data(), numNodes, double());
+        put(layout.nodeGeneration, nodeGeneration.data(), numNodes, double());
+        put(layout.nodeActive, nodeStatus.data(), numNodes, char());
+        put(layout.names, refs.data(), numNodes, NameRef());
+        put(layout.lines, lines.data(), m, ::Line());
+        put(layout.lineCapacity, lineCapacity.data(), m, double());
+        put(layout.lineLoad, state.lineLoads.data(), m, double());
+        put(layout.lineActive, lineStatus.data(), m, char());
+        put(layout.rowStart, rowStart.data(), numNodes + 1, int());
+        put(layout.adjacency, adjacency.data(), 2 * m, ::Adjacent());
+        put(layout.nameTable, table.data(), table.size(), char());
+
+        SnapshotHeader header;
+        memcpy(header.magic, snapshotMagic, 8);
+        header.version = snapshotVersion;
+        header.byteOrder = snapshotByteOrder;
+        header.numNodes = numNodes;
+        header.numLines = m;
+        header.nameBytes = table.size();
+        header.fileSize = layout.end;
+        header.checksum = snapshotChecksum(image.data() + sizeof(header), image.size() - sizeof(header));
+        memcpy(image.data(), &header, sizeof(header));
+
+        ofstream out(filename, ios::binary);
+        if (!out || !out.write(image.data(), image.size())) {
+            *messages << "Error writing file: " << filename << "\n";
+            return false;
+        }
+        GRID_COUNT(BytesWritten, image.size());
+        if (verbose) *messages << "Grid saved to " << filename << "\n";
+        return true;
+    }
+
+    // Load a binary snapshot; the arrays are copied straight from the mapping,
+    // and converted when the engine's types differ from the stored ones
+    bool loadSnapshot(const string& filename) {
+        GridView view;
+        if (!view.open(filename, *messages)) return false;
+        Index n = view.numNodes(), m = view.numLines();
+        BasicGraph newGraph(n);
+        newGraph.messages = messages;
+        for (Index i = 0; i < n; i++) newGraph.nodeNames[i] = view.nodeName(i);
+        newGraph.nodeCapacity.assign(view.nodeCapacity(), view.nodeCapacity() + n);
+        newGraph.nodeGeneration.assign(view.nodeGeneration(), view.nodeGeneration() + n);
+        newGraph.lines.assign(view.lines(), view.lines() + m);
+        newGraph.lineCapacity.assign(view.lineCapacity(), view.lineCapacity() + m);
+        newGraph.state.nodeLoads.assign(view.nodeLoad(), view.nodeLoad() + n);
+        newGraph.state.nodeActive.assignBytes(view.nodeActive(), n);
+        newGraph.state.lineLoads.assign(view.lineLoad(), view.lineLoad() + m);
+        newGraph.state.lineActive.assignBytes(view.lineActive(), m);
+        newGraph.rowStart.assign(view.rowStart(), view.rowStart() + n + 1);
+        newGraph.adjacency.assign(view.adjacency(), view.adjacency() + 2 * m);
+        newGraph.topologyDirty = false;
+        bool wasVerbose = verbose;
+        *this = move(newGraph);
+        verbose = wasVerbose;
+        if (verbose) *messages << "Grid loaded from " << filename << "\n";
+        return true;
+    }
+
+    // Import a MATPOWER case. Buses become nodes named B<number> carrying
+    // their real demand Pd; in-service branches become lines rated at rateA
+    // (MW) with reactance x, loaded with |PF| when the case holds a solved
+    // flow and oriented along it, so the DC model sees each flow's direction.
+    // Parallel branches are merged, netting their flows. A node's capacity is the total
+    // rating of its lines, and isolated buses (type 4) start out of service.
+    // A bus generates the Pmax of its in-service generators; cases without
+    // a gen table leave every bus supplying its own demand.
+    bool loadMatpower(const string& filename) {
+        MappedFile file;
+        if (!file.open(filename, *messages)) return false;
+        const char* data = file.data();
+        const char* end = data + file.size();
+        MatpowerTable buses, branches, gens;
+        if (!readMatpowerTable(data, end, "bus", buses, true, *messages)
+            || !readMatpowerTable(data, end, "branch", branches, true, *messages)
+            || !readMatpowerTable(data, end, "gen", gens, false, *messages)) {
+            return false;
+        }
+        Index n = static_cast<Index>(buses.rows.size());
+        if (n == 0) {
+            *messages << "Case file has no buses.\n";
+            return false;
+        }
+
+        unordered_map<long long, Index> index; // Bus number -> node index
+        for (Index i = 0; i < n; i++) {
+            const vector<double>& row = buses.rows[i];
+            if (row.size() < 3) {
+                *messages << "Invalid bus data at line " << buses.lineNumbers[i] << ". Expected: bus_i type Pd ...\n";
+                return false;
+            }
+            if (!index.emplace(static_cast<long long>(row[0]), i).second) {
+                *messages << "Duplicate bus " << static_cast<long long>(row[0]) << " at line " << buses.lineNumbers[i] << ".\n";
+                return false;
+            }
+        }
+
+        // Merge in-service branches by endpoint pair, keeping first-seen order
+        vector<Line> merged;
+        vector<double> mergedRating, mergedLoad;
+        unordered_map<LineKey, Index, LineKeyHash> mergedIndex;
+        for (size_t k = 0; k < branches.rows.size(); k++) {
+            const vector<double>& row = branches.rows[k];
+            int lineNumber = branches.lineNumbers[k];
+            if (row.size() < 6) {
+                *messages << "Invalid branch data at line " << lineNumber << ". Expected: fbus tbus r x b rateA ...\n";
+                return false;
+            }
+            if (row.size() > 10 && row[10] == 0) continue; // Out of service
+            auto from = index.find(static_cast<long long>(row[0]));
+            auto to = index.find(static_cast<long long>(row[1]));
+            if (from == index.end() || to == index.end()) {
+                *messages << "Unknown bus " << static_cast<long long>(from == index.end() ? row[0] : row[1])
+                     << " at line " << lineNumber << ".\n";
+                return false;
+            }
+            if (from->second == to->second) {
+                *messages << "Branch at line " << lineNumber << " connects bus " << static_cast<long long>(row[0]) << " to itself.\n";
+                return false;
+            }
+            double rating = row[5] > 0 ? row[5] : unlimitedRating;
+            double flow = row.size() > 13 ? row[13] : 0.0; // fbus -> tbus
+            double reactance = max(fabs(row[3]), minReactance);
+            auto slot = mergedIndex.emplace(lineKey(from->second, to->second), static_cast<Index>(merged.size()));
+            if (slot.second) {
+                merged.push_back({from->second, to->second, reactance});
+                mergedRating.push_back(rating);
+                mergedLoad.push_back(flow);
+            } else {
+                // Parallel branches: ratings add, reactances combine in parallel
+                Line& l = merged[slot.first->second];
+                mergedRating[slot.first->second] += rating;
+                l.reactance = 1.0 / (1.0 / l.reactance + 1.0 / reactance);
+                mergedLoad[slot.first->second] += l.from == from->second ? flow : -flow;
+            }
+        }
+        // Point each line the way its flow runs
+        for (size_t k = 0; k < merged.size(); k++) {
+            if (mergedLoad[k] < 0) {
+                swap(merged[k].from, merged[k].to);
+                mergedLoad[k] = -mergedLoad[k];
+            }
+        }
+
+        // Generation at a bus is the total Pmax of its in-service generators
+        vector<double> generation(n, 0.0);
+        for (size_t k = 0; k < gens.rows.size(); k++) {
+            const vector<double>& row = gens.rows[k];
+            if (row.size() < 2) {
+                *messages << "Invalid generator data at line " << gens.lineNumbers[k] << ". Expected: bus Pg ...\n";
+                return false;
+            }
+            if (row.size() > 7 && row[7] <= 0) continue; // Out of service
+            auto bus = index.find(static_cast<long long>(row[0]));
+            if (bus == index.end()) {
+                *messages << "Unknown bus " << static_cast<long long>(row[0]) << " at line " << gens.lineNumbers[k] << ".\n";
+                return false;
+            }
+            generation[bus->second] += max(row.size() > 8 ? row[8] : row[1], 0.0);
+        }
+
+        vector<double> capacity(n, 0.0);
+        for (size_t k = 0; k < merged.size(); k++) {
+            capacity[merged[k].from] += mergedRating[k];
+            capacity[merged[k].to] += mergedRating[k];
+        }
+        BasicGraph newGraph(n);
+        newGraph.messages = messages;
+        for (Index i = 0; i < n; i++) {
+            double load = max(buses.rows[i][2], 0.0);
+            double maxCapacity = max(capacity[i], load);
+            if (maxCapacity <= 0) maxCapacity = unlimitedRating;
+            if (!newGraph.addNode(i, "B" + to_string(static_cast<long long>(buses.rows[i][0])), load, maxCapacity)) return false;
+            if (buses.rows[i].size() > 1 && buses.rows[i][1] == 4) newGraph.state.nodeActive.set(i, false);
+            if (!gens.rows.empty()) newGraph.nodeGeneration[i] = generation[i];
+        }
+        newGraph.reserveLines(merged.size());
+        for (size_t k = 0; k < merged.size(); k++) {
+            if (!newGraph.addEdge(merged[k].from, merged[k].to, mergedRating[k], mergedLoad[k], merged[k].reactance)) return false;
+        }
+        bool wasVerbose = verbose;
+        *this = move(newGraph);
+        verbose = wasVerbose;
+        if (verbose) *messages << "Grid imported from " << filename << "\n";
+        return true;
+    }
+
+    // Load grid from file: a binary snapshot, a MATPOWER case (.m) or the text format
+    bool loadGrid(const string& filename) {
+        if (GridView::isSnapshot(filename)) return loadSnapshot(filename);
+        if (filename.size() > 2 && filename.compare(filename.size() - 2, 2, ".m") == 0) return loadMatpower(filename);
+        MappedFile file;
+        if (!file.open(filename, *messages) || !loadText(file.data(), file.size())) return false;
+        if (verbose) *messages << "Grid loaded from " << filename << "\n";
+        return true;
+    }
+
+    // Load a grid in the text format from memory
+    bool loadText(const char* data, size_t size) {
+        const char* end = data + size;
+        TextCursor text(data, end);
+        Index n;
+        TextCursor header = text.nextLine();
+        if (!header.number(n) || n <= 0) {
+            *messages << "Invalid number of nodes in file. Must be > 0.\n";
+            return false;
+        }
+        BasicGraph newGraph(n);
+        newGraph.messages = messages;
+        for (Index i = 0; i < n; i++) {
+            if (text.atEnd()) {
+                *messages << "Unexpected end of file at line " << i + 2 << ".\n";
+                return false;
+            }
+            TextCursor row = text.nextLine();
+            string name;
+            double load, maxCapacity;
+            if (!row.word(name) || !row.number(load) || !row.number(maxCapacity)) {
+                *messages << "Invalid node data at line " << i + 2 << ". Expected: name load maxCapacity.\n";
+                return false;
+            }
+            if (load < 0) {
+                *messages << "Invalid load at line " << i + 2 << ". Load must be >= 0.\n";
+                return false;
+            }
+            if (maxCapacity <= 0) {
+                *messages << "Invalid max capacity at line " << i + 2 << ". Max capacity must be > 0.\n";
+                return false;
+            }
+            if (load > maxCapacity) {
+                *messages << "Invalid load at line " << i + 2 << ". Load must be <= max capacity.\n";
+                return false;
+            }
+            if (!newGraph.addNode(i, name, load, maxCapacity)) {
+                return false;
+            }
+            double generation;
+            if (row.number(generation)) {
+                if (generation < 0) {
+                    *messages << "Invalid generation at line " << i + 2 << ". Generation must be >= 0.\n";
+                    return false;
+                }
+                newGraph.nodeGeneration[i] = generation;
+            }
+        }
+        Index m;
+        TextCursor count = text.nextLine();
+        if (!count.number(m) || m < 0) {
+            *messages << "Invalid number of edges in file. Must be >= 0.\n";
+            return false;
+        }
+        vector<ParsedEdge> edges = parseEdgeLines(text.position(), end, m);
+        newGraph.reserveLines(m);
+        for (Index i = 0; i < m; i++) {
+            if (i >= static_cast<Index>(edges.size())) {
+                *messages << "Unexpected end of file at line " << i + n + 3 << ".\n";
+                return false;
+            }
+            const ParsedEdge& e = edges[i];
+            if (!e.ok) {
+                *messages << "Invalid edge data at line " << i + n + 3 << ". Expected: u v load capacity [reactance].\n";
+                return false;
+            }
+            if (e.u < 0 || e.u >= n || e.v < 0 || e.v >= n) {
+                *messages << "Invalid node indices at line " << i + n + 3 << ". Indices must be between 0 and " << n - 1 << ".\n";
+                return false;
+            }
+            if (e.load < 0) {
+                *messages << "Invalid load at line " << i + n + 3 << ". Load must be >= 0.\n";
+                return false;
+            }
+            if (e.capacity <= 0) {
+                *messages << "Invalid capacity at line " << i + n + 3 << ". Capacity must be > 0.\n";
+                return false;
+            }
+            if (e.reactance <= 0) {
+                *messages << "Invalid reactance at line " << i + n + 3 << ". Reactance must be > 0.\n";
+                return false;
+            }
+            if (!newGraph.addEdge(e.u, e.v, e.capacity, e.load, e.reactance)) {
+                return false;
+            }
+        }
+        bool wasVerbose = verbose;
+        *this = move(newGraph); // Use move to avoid unnecessary copying
+        verbose = wasVerbose;
+        return true;
+    }
+
+    // Getter for node name
+    string getNodeName(Index idx) const {
+        if (idx >= 0 && idx < numNodes) {
+            return nodeNames[idx];
+        }
+        return "Unknown";
+    }
+};
+
+using Graph = BasicGraph<double, int>;
+
+// Presets selectable at the command line: single precision and 32-bit
+// indices halve the hot arrays for screening studies, and 64-bit indices
+// lift the 2^31 element limit for huge models
+using FastGraph = BasicGraph<float, int32_t>;
+using HugeGraph = BasicGraph<double, int64_t>;
+
+// Shared pool sized to the machine, created on first use
+inline WorkStealingPool& defaultPool() {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+// Prints every cascade step in the interactive menu's format. st is the state
+// the cascade runs on, reported when it finishes.
+template <typename Real, typename Index>
+class BasicConsoleObserver : public BasicCascadeObserver<Index> {
+private:
+    using Graph = BasicGraph<Real, Index>;
+    const Graph& grid;
+    const typename Graph::GridState& st;
+    ostream& out;
+    bool saveDot; // Also write grid.dot when the cascade finishes
+    string lineName(Index line) const {
+        return grid.getNodeName(grid.getLine(line).from) + "-" + grid.getNodeName(grid.getLine(line).to);
+    }
+public:
+    BasicConsoleObserver(const Graph& g, const typename Graph::GridState& state, ostream& os = cout, bool dot = true)
+        : grid(g), st(state), out(os), saveDot(dot) {}
+    void onStart(double loadIncreasePercent, bool randomLoad) override {
+        out << "\nSimulating load increase by " << loadIncreasePercent << "% "
+             << (randomLoad ? "with random variations" : "uniformly") << "\n";
+    }
+    void onNodeLoadIncrease(Index node, double oldLoad, double newLoad, double factor) override {
+        out << "Node " << grid.getNodeName(node) << ": Load increased from " << fixed << setprecision(2)
+             << oldLoad << " to " << newLoad << " MW (factor = " << factor << ")\n";
+    }
+    void onLineLoadIncrease(Index line, double oldLoad, double newLoad, double factor) override {
+        out << "Edge " << lineName(line) << ": Load increased from "
+             << fixed << setprecision(2) << oldLoad << " to " << newLoad << " MW (factor = " << factor << ")\n";
+    }
+    void onOverloadCheck(size_t nodes, size_t lines, bool initial) override {
+        out << (initial ? "Initial" : "Rechecked") << " Overloaded Nodes: " << nodes << ", Overloaded Edges: " << lines << "\n";
+    }
+    void onFailure(const BasicFailureEvent<Index>& ev) override {
+        if (ev.line == -1) {
+            out << "Node " << grid.getNodeName(ev.node);
+        } else {
+            out << "Edge " << lineName(ev.line);
+        }
+        if (ev.forced) {
+            out << " taken out of service\n";
+        } else {
+            out << " failed (load = " << fixed << setprecision(2) << ev.load << " MW, capacity = " << ev.capacity << " MW)\n";
+        }
+    }
+    void onRedistribute(Index from, Index line, double amount) override {
+        const typename Graph::Line& l = grid.getLine(line);
+        out << "Redistributed " << fixed << setprecision(2) << amount << " MW to edge "
+             << grid.getNodeName(from) << "-" << grid.getNodeName(l.from == from ? l.to : l.from) << "\n";
+    }
+    void onNoSpareCapacity(Index node) override {
+        out << "Warning: No available capacity to redistribute load from node " << grid.getNodeName(node) << "\n";
+    }
+    void onDemandTransfer(Index from, Index to, double amount) override {
+        if (to == -1) {
+            out << "Warning: No neighbour can take the " << fixed << setprecision(2) << amount << " MW demand of node "
+                 << grid.getNodeName(from) << "\n";
+        } else {
+            out << "Transferred " << fixed << setprecision(2) << amount << " MW of demand from node "
+                 << grid.getNodeName(from) << " to node " << grid.getNodeName(to) << "\n";
+        }
+    }
+    void onShed(Index node, double keep) override {
+        if (keep == 0) {
+            out << "Island of node " << grid.getNodeName(node) << " blacked out\n";
+        } else {
+            out << "Island of node " << grid.getNodeName(node) << " shed " << fixed << setprecision(2)
+                 << (1 - keep) * 100 << "% of its load\n";
+        }
+    }
+    void onFinish(const BasicCascadeResult<Index>& result) override {
+        // The timeline is empty when the cascade ran without islandTimeline
+        for (size_t k = 0; k < min(result.events.size(), result.timeline.size()); k++) {
+            const BasicIslandStep<Index>& step = result.timeline[k];
+            if (step.pieces.empty()) continue;
+            const BasicFailureEvent<Index>& ev = result.events[k];
+            out << "Islanding: loss of " << (ev.line == -1 ? "node " + grid.getNodeName(ev.node) : "edge " + lineName(ev.line))
+                 << " split the grid into " << step.islands << " islands (sizes";
+            for (Index p : step.pieces) out << " " << p;
+            out << ")\n";
+        }
+        // Called before the grid is restored, so this reports the final state
+        grid.reportGridState(st, out);
+        if (saveDot) grid.saveGridVisualization("grid.dot");
+    }
+};
+
+using ConsoleObserver = BasicConsoleObserver<double, int>;
+
+// Bounded lock-free queue for exactly one producer and one consumer thread
+template <typename T>
+class SpscRing {
+private:
+    vector<T> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> head{0}; // Next slot to read, owned by the consumer
+    alignas(64) atomic<size_t> tail{0}; // Next slot to write, owned by the producer
+
+public:
+    explicit SpscRing(size_t capacityPow2) : slots(capacityPow2), mask(capacityPow2 - 1) {}
+
+    bool tryPush(const T& item) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size()) return false;
+        slots[t & mask] = item;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots.size(); }
+    size_t size() const { return tail.load(memory_order_acquire) - head.load(memory_order_acquire); }
+
+    // Copy out up to max items; returns how many were taken
+    size_t popMany(T* out, size_t max) {
+        size_t h = head.load(memory_order_relaxed);
+        size_t n = min(tail.load(memory_order_acquire) - h, max);
+        for (size_t i = 0; i < n; i++) out[i] = slots[(h + i) & mask];
+        head.store(h + n, memory_order_release);
+        return n;
+    }
+};
+
+// One entry of a binary cascade trace. The meaning of a, b and x..z depends on kind.
+struct TraceRecord {
+    enum Kind : uint32_t {
+        Start, // x = load increase %, flag = random
+        NodeLoad, // a = node, x = old load, y = new load, z = factor
+        LineLoad, // a = line, x = old load, y = new load, z = factor
+        OverloadCheck, // a = overloaded nodes, b = overloaded lines, flag = initial
+        Failure, // a = node, b = line (one is -1), x = load, y = capacity, flag = forced
+        Redistribute, // a = from node, b = line, x = MW
+        NoSpareCapacity, // a = node
+        IslandSplit, // a = event index, b = islands, x = largest island, flag = piece count
+        IslandPiece, // a = piece size; follows its IslandSplit
+        Finish,
+        DemandTransfer, // a = failed node, b = receiving node or -1 if dropped, x = MW
+        Shed // a = node of the island, x = share of its loads kept
+    };
+    uint64_t time; // Nanoseconds since the trace was opened
+    uint32_t kind;
+    int32_t a, b;
+    uint32_t flag;
+    double x, y, z;
+};
+
+// Trace file header; the records follow as raw TraceRecords
+struct TraceHeader {
+    char magic[8]; // "EGRTRACE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t numNodes;
+    uint64_t numLines;
+};
+
+const char traceMagic[8] = {'E', 'G', 'R', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t traceVersion = 2; // Version 1 lacks the demand transfer and shed records
+
+// Appends trace records to a file from a background thread. The simulation
+// thread only copies records into a ring buffer and waits only if the writer
+// falls a full ring behind, so no record is ever dropped. The writer sleeps
+// until the ring fills halfway, the trace is closed or flushPeriod passes, so
+// a quiet run still reaches the file within one period.
+class TraceWriter {
+private:
+    SpscRing<TraceRecord> ring;
+    ofstream file;
+    thread writer;
+    mutex wakeLock;
+    condition_variable wake;
+    bool closing = false;
+    chrono::steady_clock::time_point opened;
+    static constexpr chrono::milliseconds flushPeriod{100};
+
+    void drain() {
+        vector<TraceRecord> batch(4096);
+        const size_t half = ring.capacity() / 2;
+        while (true) {
+            bool last;
+            {
+                unique_lock<mutex> lk(wakeLock);
+                wake.wait_for(lk, flushPeriod, [&] { return closing || ring.size() >= half; });
+                last = closing;
+            }
+            size_t n;
+            while ((n = ring.popMany(batch.data(), batch.size())) > 0) {
+                file.write(reinterpret_cast<const char*>(batch.data()), n * sizeof(TraceRecord));
+                GRID_COUNT(BytesWritten, n * sizeof(TraceRecord));
+            }
+            file.flush();
+            if (last) break;
+        }
+    }
+
+public:
+    TraceWriter() : ring(1 << 16) {}
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+    ~TraceWriter() { close(); }
+
+    // Records hold 32-bit element IDs, so larger grids are refused
+    bool open(const string& filename, uint64_t numNodes, uint64_t numLines) {
+        if (numNodes > static_cast<uint64_t>(numeric_limits<int>::max())
+            || numLines > static_cast<uint64_t>(numeric_limits<int>::max())) {
+            cout << "Grid is too large for a trace: " << filename << "\n";
+            return false;
+        }
+        file.open(filename, ios::binary);
+        if (!file) {
+            cout << "Error opening file: " << filename << "\n";
+            return false;
+        }
+        TraceHeader header;
+        memcpy(header.magic, traceMagic, 8);
+        header.version = traceVersion;
+        header.recordSize = sizeof(TraceRecord);
+        header.numNodes = numNodes;
+        header.numLines = numLines;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        GRID_COUNT(BytesWritten, sizeof(header));
+        opened = chrono::steady_clock::now();
+        closing = false;
+        writer = thread(&TraceWriter::drain, this);
+        return true;
+    }
+
+    // Does nothing unless the trace is open
+    void record(uint32_t kind, int a = -1, int b = -1, double x = 0, double y = 0, double z = 0, uint32_t flag = 0) {
+        if (!writer.joinable()) return;
+        TraceRecord r;
+        r.time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - opened).count();
+        r.kind = kind;
+        r.a = a;
+        r.b = b;
+        r.flag = flag;
+        r.x = x;
+        r.y = y;
+        r.z = z;
+        while (!ring.tryPush(r)) this_thread::yield();
+        // Each push grows the ring by one, so rising past half full always lands on it
+        if (ring.size() == ring.capacity() / 2) {
+            lock_guard<mutex> lk(wakeLock);
+            wake.notify_one();
+        }
+    }
+
+    // Flush everything recorded so far and stop the writer thread
+    bool close() {
+        if (!writer.joinable()) return static_cast<bool>(file);
+        {
+            lock_guard<mutex> lk(wakeLock);
+            closing = true;
+        }
+        wake.notify_one();
+        writer.join();
+        file.close();
+        return !file.fail();
+    }
+};
+
+// Records every cascade step into a trace. Records hold 32-bit indices, which
+// fit every grid TraceWriter::open accepts.
+template <typename Index>
+class BasicTraceObserver : public BasicCascadeObserver<Index> {
+private:
+    TraceWriter& trace;
+public:
+    BasicTraceObserver(TraceWriter& t) : trace(t) {}
+    void onStart(double loadIncreasePercent, bool randomLoad) override {
+        trace.record(TraceRecord::Start, -1, -1, loadIncreasePercent, 0, 0, randomLoad);
+    }
+    void onNodeLoadIncrease(Index node, double oldLoad, double newLoad, double factor) override {
+        trace.record(TraceRecord::NodeLoad, static_cast<int>(node), -1, oldLoad, newLoad, factor);
+    }
+    void onLineLoadIncrease(Index line, double oldLoad, double newLoad, double factor) override {
+        trace.record(TraceRecord::LineLoad, static_cast<int>(line), -1, oldLoad, newLoad, factor);
+    }
+    void onOverloadCheck(size_t nodes, size_t lines, bool initial) override {
+        trace.record(TraceRecord::OverloadCheck, static_cast<int>(nodes), static_cast<int>(lines), 0, 0, 0, initial);
+    }
+    void onFailure(const BasicFailureEvent<Index>& ev) override {
+        trace.record(TraceRecord::Failure, static_cast<int>(ev.node), static_cast<int>(ev.line), ev.load, ev.capacity, 0, ev.forced);
+    }
+    void onRedistribute(Index from, Index line, double amount) override {
+        trace.record(TraceRecord::Redistribute, static_cast<int>(from), static_cast<int>(line), amount);
+    }
+    void onNoSpareCapacity(Index node) override {
+        trace.record(TraceRecord::NoSpareCapacity, static_cast<int>(node));
+    }
+    void onDemandTransfer(Index from, Index to, double amount) override {
+        trace.record(TraceRecord::DemandTransfer, static_cast<int>(from), static_cast<int>(to), amount);
+    }
+    void onShed(Index node, double keep) override {
+        trace.record(TraceRecord::Shed, static_cast<int>(node), -1, keep);
+    }
+    void onFinish(const BasicCascadeResult<Index>& result) override {
+        for (size_t k = 0; k < result.timeline.size(); k++) {
+            const BasicIslandStep<Index>& step = result.timeline[k];
+            if (step.pieces.empty()) continue;
+            trace.record(TraceRecord::IslandSplit, static_cast<int>(k), static_cast<int>(step.islands), static_cast<double>(step.largest), 0, 0,
+                         static_cast<uint32_t>(step.pieces.size()));
+            for (Index p : step.pieces) trace.record(TraceRecord::IslandPiece, static_cast<int>(p));
+        }
+        trace.record(TraceRecord::Finish);
+    }
+};
+
+using TraceObserver = BasicTraceObserver<int>;
+
+template <typename Real, typename Index>
+inline void BasicGraph<Real, Index>::simulateCascadingFailures(double loadIncreasePercent, bool randomLoad) {
+    if (loadIncreasePercent < 0) {
+        cout << "Load increase percentage must be >= 0.\n";
+        return;
+    }
+    CascadeOptions options;
+    options.loadIncreasePercent = loadIncreasePercent;
+    options.randomLoad = randomLoad;
+    options.seed = static_cast<uint64_t>(time(nullptr));
+    BasicConsoleObserver<Real, Index> console(*this, state);
+    runCascade(options, &console);
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include "grid_c.h"
+#include "grid.h"
+
+static_assert(sizeof(GridLine) == sizeof(Line) && offsetof(GridLine, to) == offsetof(Line, to)
+                  && offsetof(GridLine, reactance) == offsetof(Line, reactance),
+              "GridLine must match the engine's line layout");
+
+struct GridEngine {
+    ostringstream messages; // The engine's messages, read back as the error of a failed load
+    Graph grid{1};
+    GridState work; // Working state, overwritten in place so its arrays never move
+    CascadeScratch scratch; // Reused by every simulate, so repeated runs do not allocate
+    CascadeResult result;
+    vector<GridFailure> failures;
+    int32_t islands = 0;
+    int32_t baseIslands = 0; // Islands of the loaded grid
+    vector<int32_t> criticalNodes;
+    vector<GridCriticalLine> criticalLines;
+    unique_ptr<WorkStealingPool> pool; // Kept for the next screen with the same thread count
+    bool loaded = false; // A grid_load_* has succeeded
+    string error;
+    mutable string name; // Last name returned by grid_node_name
+};
+
+// Load a grid into g with the engine's messages as the error. Each handle
+// has its own message stream, so loads on separate handles may run at once.
+static int loadInto(GridEngine* g, const function<bool(Graph&)>& load) {
+    Graph grid(1);
+    grid.setVerbose(false);
+    g->messages.str("");
+    grid.setMessages(g->messages);
+    bool ok = load(grid);
+    if (!ok) {
+        g->error = g->messages.str();
+        while (!g->error.empty() && g->error.back() == '\n') g->error.pop_back();
+        if (g->error.empty()) g->error = "Invalid grid";
+        return -1;
+    }
+    g->grid = move(grid);
+    g->work = g->grid.getState();
+    g->failures.clear();
+    g->baseIslands = static_cast<int32_t>(g->grid.findComponents().count());
+    g->islands = g->baseIslands;
+    g->criticalNodes.clear();
+    g->criticalLines.clear();
+    g->loaded = true;
+    g->error.clear();
+    return 0;
+}
+
+extern "C" {
+
+int grid_abi_version(void) { return GRID_ABI_VERSION; }
+
+GridEngine* grid_create(void) {
+    GridEngine* g = new GridEngine;
+    g->grid.setVerbose(false);
+    g->grid.setMessages(g->messages);
+    g->work = g->grid.getState();
+    g->baseIslands = g->islands = 1;
+    return g;
+}
+
+void grid_destroy(GridEngine* g) { delete g; }
+
+const char* grid_last_error(const GridEngine* g) { return g->error.c_str(); }
+
+int grid_load_file(GridEngine* g, const char* path) {
+    return loadInto(g, [&](Graph& grid) { return grid.loadGrid(path); });
+}
+
+int grid_load_text(GridEngine* g, const char* data, size_t size) {
+    return loadInto(g, [&](Graph& grid) { return grid.loadText(data, size); });
+}
+
+int32_t grid_num_nodes(const GridEngine* g) { return g->grid.getNumNodes(); }
+int32_t grid_num_lines(const GridEngine* g) { return g->grid.getNumLines(); }
+
+const char* grid_node_name(const GridEngine* g, int32_t node) {
+    if (node < 0 || node >= g->grid.getNumNodes()) return nullptr;
+    g->name = g->grid.getNodeName(node);
+    return g->name.c_str();
+}
+
+const GridLine* grid_lines(const GridEngine* g) { return reinterpret_cast<const GridLine*>(g->grid.getLines()); }
+const double* grid_node_capacity(const GridEngine* g) { return g->grid.getNodeCapacities(); }
+const double* grid_line_capacity(const GridEngine* g) { return g->grid.getLineCapacities(); }
+
+const double* grid_node_load(const GridEngine* g) { return g->work.nodeLoads.data(); }
+const double* grid_line_load(const GridEngine* g) { return g->work.lineLoads.data(); }
+const uint64_t* grid_node_active(const GridEngine* g) { return g->work.nodeActive.words(); }
+const uint64_t* grid_line_active(const GridEngine* g) { return g->work.lineActive.words(); }
+
+void grid_reset(GridEngine* g) {
+    // Element-wise copies: same sizes, so no array is reallocated
+    const GridState& base = g->grid.getState();
+    copy(base.nodeLoads.begin(), base.nodeLoads.end(), g->work.nodeLoads.begin());
+    copy(base.lineLoads.begin(), base.lineLoads.end(), g->work.lineLoads.begin());
+    for (size_t i = 0; i < base.nodeActive.size(); i++) g->work.nodeActive.set(i, base.nodeActive[i]);
+    for (size_t id = 0; id < base.lineActive.size(); id++) g->work.lineActive.set(id, base.lineActive[id]);
+    g->failures.clear();
+    g->islands = g->baseIslands;
+}
+
+void grid_snapshot(const GridEngine* g, double* node_load, uint8_t* node_active, double* line_load,
+                   uint8_t* line_active) {
+    const GridState& st = g->work;
+    for (int i = 0; i < g->grid.getNumNodes(); i++) {
+        if (node_load) node_load[i] = st.nodeLoads[i];
+        if (node_active) node_active[i] = st.nodeActive[i];
+    }
+    for (int id = 0; id < g->grid.getNumLines(); id++) {
+        if (line_load) line_load[id] = st.lineLoads[id];
+        if (line_active) line_active[id] = st.lineActive[id];
+    }
+}
+
+int32_t grid_simulate(GridEngine* g, double percent, int random, uint64_t seed, int dc_flow,
+                      const int32_t* out_nodes, size_t num_out_nodes, const int32_t* out_lines,
+                      size_t num_out_lines) {
+    if (!g->loaded) {
+        g->error = "No grid loaded";
+        return -1;
+    }
+    if (percent < 0) {
+        g->error = "Load increase percentage must be >= 0";
+        return -1;
+    }
+    CascadeOptions options;
+    options.loadIncreasePercent = percent;
+    options.randomLoad = random != 0;
+    options.seed = seed;
+    options.dcFlow = dc_flow != 0;
+    options.islandTimeline = false;
+    for (size_t k = 0; k < num_out_nodes; k++) {
+        if (out_nodes[k] < 0 || out_nodes[k] >= g->grid.getNumNodes()) {
+            g->error = "Node index out of range: " + to_string(out_nodes[k]);
+            return -1;
+        }
+        options.outages.nodes.push_back(out_nodes[k]);
+    }
+    for (size_t k = 0; k < num_out_lines; k++) {
+        if (out_lines[k] < 0 || out_lines[k] >= g->grid.getNumLines()) {
+            g->error = "Line index out of range: " + to_string(out_lines[k]);
+            return -1;
+        }
+        options.outages.lines.push_back(out_lines[k]);
+    }
+
+    grid_reset(g);
+    g->grid.prepare(options.dcFlow);
+    g->grid.runCascade(g->work, options, g->scratch, g->result);
+    const CascadeResult& r = g->result;
+    g->failures.clear();
+    for (const FailureEvent& e : r.events) g->failures.push_back({e.node, e.line, e.load, e.capacity, e.forced});
+    g->islands = static_cast<int32_t>(r.islands.count());
+    g->error.clear();
+    return static_cast<int32_t>(g->failures.size());
+}
+
+const GridFailure* grid_failures(const GridEngine* g, size_t* count) {
+    *count = g->failures.size();
+    return g->failures.data();
+}
+
+int32_t grid_islands(const GridEngine* g) { return g->islands; }
+
+int grid_contingency(GridEngine* g, uint32_t threads) {
+    if (!g->loaded) {
+        g->error = "No grid loaded";
+        return -1;
+    }
+    unsigned workers = max(1u, threads ? threads : thread::hardware_concurrency());
+    if (!g->pool || g->pool->size() != workers) g->pool.reset(new WorkStealingPool(workers));
+    CriticalReport report = g->grid.analyzeCriticalComponents(g->pool.get());
+    g->criticalNodes.assign(report.nodes.begin(), report.nodes.end());
+    g->criticalLines.clear();
+    for (const CriticalLine& c : report.lines) g->criticalLines.push_back({c.line, c.disconnects});
+    g->error.clear();
+    return 0;
+}
+
+const int32_t* grid_critical_nodes(const GridEngine* g, size_t* count) {
+    *count = g->criticalNodes.size();
+    return g->criticalNodes.data();
+}
+
+const GridCriticalLine* grid_critical_lines(const GridEngine* g, size_t* count) {
+    *count = g->criticalLines.size();
+    return g->criticalLines.data();
+}
+
+}
@@ -0,0 +1,112 @@
+// C interface to the cascade engine, built as the gridengine shared library.
+//
+// A handle owns one resident grid and a working copy of its state. The
+// node_* and line_* arrays returned below point straight into the engine's
+// storage: they stay valid, at the same address, until the next grid_load_*
+// or grid_destroy, and every simulate or reset rewrites them in place. So a
+// caller can wrap each array once (e.g. as a numpy array) and read it after
+// every call. A handle must not be used from two threads at once, but
+// separate handles may be used from separate threads. The library prints
+// nothing; errors are reported only through grid_last_error.
+//
+// Functions returning int give 0 on success and -1 on failure, with the
+// reason in grid_last_error.
+#ifndef GRID_C_H
+#define GRID_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define GRID_API __declspec(dllexport)
+#else
+#define GRID_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a signature or struct below changes
+#define GRID_ABI_VERSION 1
+
+typedef struct GridEngine GridEngine;
+
+// A transmission line, laid out as the engine stores it
+typedef struct {
+    int32_t from, to;
+    double reactance;
+} GridLine;
+
+// One failure of the last cascade; node or line is -1
+typedef struct {
+    int32_t node;
+    int32_t line;
+    double load; // MW at the time of failure
+    double capacity;
+    int32_t forced; // Taken out by the contingency rather than by an overload
+} GridFailure;
+
+// A line found by the N-1 screen
+typedef struct {
+    int32_t line;
+    int32_t disconnects; // Otherwise its outage overloads other elements
+} GridCriticalLine;
+
+GRID_API int grid_abi_version(void);
+
+GRID_API GridEngine* grid_create(void);
+GRID_API void grid_destroy(GridEngine* g);
+GRID_API const char* grid_last_error(const GridEngine* g);
+
+// Load a text, snapshot or MATPOWER file, or a text grid held in memory
+GRID_API int grid_load_file(GridEngine* g, const char* path);
+GRID_API int grid_load_text(GridEngine* g, const char* data, size_t size);
+
+GRID_API int32_t grid_num_nodes(const GridEngine* g);
+GRID_API int32_t grid_num_lines(const GridEngine* g);
+GRID_API const char* grid_node_name(const GridEngine* g, int32_t node);
+
+// Fixed grid data
+GRID_API const GridLine* grid_lines(const GridEngine* g);
+GRID_API const double* grid_node_capacity(const GridEngine* g);
+GRID_API const double* grid_line_capacity(const GridEngine* g);
+
+// Working state. Status is one bit per element, element i in bit i % 64 of
+// word i / 64, in native byte order.
+GRID_API const double* grid_node_load(const GridEngine* g);
+GRID_API const double* grid_line_load(const GridEngine* g);
+GRID_API const uint64_t* grid_node_active(const GridEngine* g);
+GRID_API const uint64_t* grid_line_active(const GridEngine* g);
+
+// Return the working state to the loaded grid and clear the last cascade
+GRID_API void grid_reset(GridEngine* g);
+
+// Copy the working state into caller arrays, one byte per status
+GRID_API void grid_snapshot(const GridEngine* g, double* node_load, uint8_t* node_active, double* line_load,
+                            uint8_t* line_active);
+
+// Run one cascade from the loaded grid, leaving its final state in the
+// working arrays. random draws each element's factor from the stream seed;
+// dc_flow moves failed flows by DC power flow. Outages are forced before the
+// cascade. Returns the number of failures, or -1 (also if no grid is loaded).
+GRID_API int32_t grid_simulate(GridEngine* g, double percent, int random, uint64_t seed, int dc_flow,
+                               const int32_t* out_nodes, size_t num_out_nodes, const int32_t* out_lines,
+                               size_t num_out_lines);
+
+// Failures of the last cascade in order, and its island count
+GRID_API const GridFailure* grid_failures(const GridEngine* g, size_t* count);
+GRID_API int32_t grid_islands(const GridEngine* g);
+
+// N-1 screen of the loaded grid over the given threads (0: all cores); -1 if
+// no grid is loaded. The report is kept until the next screen or load, and the
+// threads until a screen asks for a different number or the handle is destroyed.
+GRID_API int grid_contingency(GridEngine* g, uint32_t threads);
+GRID_API const int32_t* grid_critical_nodes(const GridEngine* g, size_t* count);
+GRID_API const GridCriticalLine* grid_critical_lines(const GridEngine* g, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
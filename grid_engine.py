@@ -0,0 +1,219 @@
+"""ctypes wrapper for the gridengine shared library (see grid_c.h).
+
+The load, capacity and status arrays are numpy views of the engine's own
+memory, so reading them after a simulate copies nothing. They keep their
+address until the next load, and each simulate or reset rewrites them in place.
+"""
+import ctypes
+import os
+import sys
+from typing import List, Optional, Sequence, Tuple
+
+import numpy as np
+
+ABI_VERSION = 1
+
+
+class GridLine(ctypes.Structure):
+    _fields_ = [("from_node", ctypes.c_int32), ("to_node", ctypes.c_int32), ("reactance", ctypes.c_double)]
+
+
+class GridFailure(ctypes.Structure):
+    _fields_ = [("node", ctypes.c_int32), ("line", ctypes.c_int32), ("load", ctypes.c_double),
+                ("capacity", ctypes.c_double), ("forced", ctypes.c_int32)]
+
+
+class GridCriticalLine(ctypes.Structure):
+    _fields_ = [("line", ctypes.c_int32), ("disconnects", ctypes.c_int32)]
+
+
+class GridEngineError(RuntimeError):
+    pass
+
+
+def _library_names() -> List[str]:
+    if sys.platform == "win32":
+        return ["gridengine.dll", "libgridengine.dll"]
+    if sys.platform == "darwin":
+        return ["libgridengine.dylib"]
+    return ["libgridengine.so"]
+
+
+def find_library() -> Optional[str]:
+    """GRID_ENGINE_LIB if set, else the library in build/ or next to this file"""
+    path = os.environ.get("GRID_ENGINE_LIB")
+    if path:
+        return path
+    here = os.path.dirname(os.path.abspath(__file__))
+    for directory in (os.path.join(here, "build"), here):
+        for name in _library_names():
+            candidate = os.path.join(directory, name)
+            if os.path.exists(candidate):
+                return candidate
+    return None
+
+
+def _bind(lib: ctypes.CDLL):
+    P = ctypes.c_void_p
+    sz = ctypes.POINTER(ctypes.c_size_t)
+    i32p = ctypes.POINTER(ctypes.c_int32)
+    signatures = {
+        "grid_abi_version": (ctypes.c_int, []),
+        "grid_create": (P, []),
+        "grid_destroy": (None, [P]),
+        "grid_last_error": (ctypes.c_char_p, [P]),
+        "grid_load_file": (ctypes.c_int, [P, ctypes.c_char_p]),
+        "grid_load_text": (ctypes.c_int, [P, ctypes.c_char_p, ctypes.c_size_t]),
+        "grid_num_nodes": (ctypes.c_int32, [P]),
+        "grid_num_lines": (ctypes.c_int32, [P]),
+        "grid_node_name": (ctypes.c_char_p, [P, ctypes.c_int32]),
+        "grid_lines": (ctypes.POINTER(GridLine), [P]),
+        "grid_node_capacity": (ctypes.POINTER(ctypes.c_double), [P]),
+        "grid_line_capacity": (ctypes.POINTER(ctypes.c_double), [P]),
+        "grid_node_load": (ctypes.POINTER(ctypes.c_double), [P]),
+        "grid_line_load": (ctypes.POINTER(ctypes.c_double), [P]),
+        "grid_node_active": (ctypes.POINTER(ctypes.c_uint64), [P]),
+        "grid_line_active": (ctypes.POINTER(ctypes.c_uint64), [P]),
+        "grid_reset": (None, [P]),
+        "grid_snapshot": (None, [P, P, P, P, P]),
+        "grid_simulate": (ctypes.c_int32, [P, ctypes.c_double, ctypes.c_int, ctypes.c_uint64, ctypes.c_int,
+                                           i32p, ctypes.c_size_t, i32p, ctypes.c_size_t]),
+        "grid_failures": (ctypes.POINTER(GridFailure), [P, sz]),
+        "grid_islands": (ctypes.c_int32, [P]),
+        "grid_contingency": (ctypes.c_int, [P, ctypes.c_uint32]),
+        "grid_critical_nodes": (i32p, [P, sz]),
+        "grid_critical_lines": (ctypes.POINTER(GridCriticalLine), [P, sz]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        fn = getattr(lib, name)
+        fn.restype = restype
+        fn.argtypes = argtypes
+
+
+_lib = None
+
+
+def load_library(path: Optional[str] = None) -> ctypes.CDLL:
+    global _lib
+    if _lib is None:
+        path = path or find_library()
+        if path is None:
+            raise GridEngineError("gridengine library not found; build it with CMake or set GRID_ENGINE_LIB")
+        lib = ctypes.CDLL(path)
+        _bind(lib)
+        if lib.grid_abi_version() != ABI_VERSION:
+            raise GridEngineError(f"{path} has ABI version {lib.grid_abi_version()}, expected {ABI_VERSION}")
+        _lib = lib
+    return _lib
+
+
+def _view(pointer, count: int, dtype) -> np.ndarray:
+    """Read-only numpy array over engine memory, without copying"""
+    if count == 0:
+        return np.zeros(0, dtype=dtype)
+    array = np.ctypeslib.as_array(pointer, shape=(count,)).view(dtype)
+    array.flags.writeable = False
+    return array
+
+
+class GridEngine:
+    """One resident grid and the working state of its last cascade"""
+
+    def __init__(self, library: Optional[str] = None):
+        self._lib = load_library(library)
+        self._handle = self._lib.grid_create()
+        self._bind_views()
+
+    def close(self):
+        if self._handle:
+            self._lib.grid_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _check(self, status: int):
+        if status < 0:
+            raise GridEngineError(self._lib.grid_last_error(self._handle).decode())
+        return status
+
+    def _bind_views(self):
+        lib, h = self._lib, self._handle
+        n, m = lib.grid_num_nodes(h), lib.grid_num_lines(h)
+        self.num_nodes, self.num_lines = n, m
+        line_dtype = np.dtype([("from", np.int32), ("to", np.int32), ("reactance", np.float64)])
+        self.lines = _view(lib.grid_lines(h), m, line_dtype)
+        self.node_capacity = _view(lib.grid_node_capacity(h), n, np.float64)
+        self.line_capacity = _view(lib.grid_line_capacity(h), m, np.float64)
+        self.node_load = _view(lib.grid_node_load(h), n, np.float64)
+        self.line_load = _view(lib.grid_line_load(h), m, np.float64)
+        self._node_words = _view(lib.grid_node_active(h), (n + 63) // 64, np.uint64)
+        self._line_words = _view(lib.grid_line_active(h), (m + 63) // 64, np.uint64)
+
+    # Status is stored as bits; these unpack the current bits to bools
+    @property
+    def node_active(self) -> np.ndarray:
+        return np.unpackbits(self._node_words.view(np.uint8), bitorder="little")[:self.num_nodes].astype(bool)
+
+    @property
+    def line_active(self) -> np.ndarray:
+        return np.unpackbits(self._line_words.view(np.uint8), bitorder="little")[:self.num_lines].astype(bool)
+
+    def load_file(self, path: str):
+        self._check(self._lib.grid_load_file(self._handle, os.fsencode(path)))
+        self._bind_views()
+
+    def load_text(self, text: str):
+        data = text.encode()
+        self._check(self._lib.grid_load_text(self._handle, data, len(data)))
+        self._bind_views()
+
+    def node_name(self, node: int) -> str:
+        name = self._lib.grid_node_name(self._handle, node)
+        if name is None:
+            raise IndexError(node)
+        return name.decode()
+
+    def reset(self):
+        self._lib.grid_reset(self._handle)
+
+    def snapshot(self) -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+        """Copies of node loads, node status, line loads and line status"""
+        node_load = np.empty(self.num_nodes)
+        node_active = np.empty(self.num_nodes, dtype=np.uint8)
+        line_load = np.empty(self.num_lines)
+        line_active = np.empty(self.num_lines, dtype=np.uint8)
+        self._lib.grid_snapshot(self._handle, node_load.ctypes.data, node_active.ctypes.data,
+                                line_load.ctypes.data, line_active.ctypes.data)
+        return node_load, node_active.astype(bool), line_load, line_active.astype(bool)
+
+    def simulate(self, percent: float, random: bool = False, seed: int = 0, dc_flow: bool = False,
+                 out_nodes: Sequence[int] = (), out_lines: Sequence[int] = ()) -> List[GridFailure]:
+        """Run one cascade from the loaded grid; returns the failures in order"""
+        nodes = (ctypes.c_int32 * len(out_nodes))(*out_nodes)
+        lines = (ctypes.c_int32 * len(out_lines))(*out_lines)
+        self._check(self._lib.grid_simulate(self._handle, percent, int(random), seed, int(dc_flow),
+                                            nodes, len(out_nodes), lines, len(out_lines)))
+        count = ctypes.c_size_t()
+        failures = self._lib.grid_failures(self._handle, ctypes.byref(count))
+        return [GridFailure.from_buffer_copy(failures[k]) for k in range(count.value)]
+
+    @property
+    def islands(self) -> int:
+        return self._lib.grid_islands(self._handle)
+
+    def contingency(self, threads: int = 0) -> Tuple[List[int], List[Tuple[int, bool]]]:
+        """N-1 screen: critical nodes, and critical lines with whether they disconnect"""
+        self._check(self._lib.grid_contingency(self._handle, threads))
+        count = ctypes.c_size_t()
+        nodes = self._lib.grid_critical_nodes(self._handle, ctypes.byref(count))
+        critical_nodes = [nodes[k] for k in range(count.value)]
+        lines = self._lib.grid_critical_lines(self._handle, ctypes.byref(count))
+        critical_lines = [(lines[k].line, bool(lines[k].disconnects)) for k in range(count.value)]
+        return critical_nodes, critical_lines
@@ -6,6 +6,12 @@ from dataclasses import dataclass
 from enum import Enum
 import json
 
+# C++ cascade engine (grid_engine.py); the Python model below is used without it
+try:
+    from grid_engine import GridEngine, GridEngineError
+except ImportError:
+    GridEngine = None
+
 # Initialize Pygame
 pygame.init()
 
@@ -297,6 +303,12 @@ class ElectricGridSimulator:
         # Simulation state (initialize before creating grid)
         self.original_state = None
         self.failure_history = []
+        self.engine = None
+        if GridEngine is not None:
+            try:
+                self.engine = GridEngine()
+            except (GridEngineError, OSError) as e:
+                print(f"Using the Python cascade model: {e}")
         
         # Demo scenarios
         self.demo_scenarios = self.create_demo_scenarios()
@@ -820,6 +832,9 @@ class ElectricGridSimulator:
         # Save original state
         self.save_state()
         
+        if self.engine is not None and self.simulate_with_engine(load_increase_percent):
+            return
+        
         # Apply load increase
         for node in self.nodes:
             if node.active:
@@ -856,6 +871,47 @@ class ElectricGridSimulator:
                     # Redistribute load
                     self.redistribute_load(edge.from_node, edge.to_node, edge.current_load)
     
+    def simulate_with_engine(self, load_increase_percent: float) -> bool:
+        """Run the cascade in the C++ engine; False if it cannot take this grid"""
+        text = [str(len(self.nodes))]
+        text += [f"{node.name.replace(' ', '_')} {node.load!r} {node.max_capacity!r}" for node in self.nodes]
+        text.append(str(len(self.edges)))
+        text += [f"{edge.from_node} {edge.to_node} {edge.current_load!r} {edge.capacity!r}" for edge in self.edges]
+        try:
+            self.engine.load_text("\n".join(text) + "\n")
+            lines = self.engine.lines
+            if any((int(lines[k]['from']), int(lines[k]['to'])) != (edge.from_node, edge.to_node)
+                   for k, edge in enumerate(self.edges)) or len(lines) != len(self.edges):
+                return False
+            # The text format has no status, so failed elements are forced out
+            failures = self.engine.simulate(
+                load_increase_percent,
+                out_nodes=[i for i, node in enumerate(self.nodes) if not node.active],
+                out_lines=[k for k, edge in enumerate(self.edges) if not edge.active])
+        except GridEngineError:
+            return False
+        
+        # Read the final state straight from the engine's arrays
+        node_active, line_active = self.engine.node_active, self.engine.line_active
+        for i, node in enumerate(self.nodes):
+            node.load = float(self.engine.node_load[i])
+            node.active = bool(node_active[i])
+        for k, edge in enumerate(self.edges):
+            edge.current_load = float(self.engine.line_load[k])
+            edge.active = bool(line_active[k])
+        
+        for failure in failures:
+            if failure.forced:
+                continue
+            if failure.node >= 0:
+                self.failure_history.append(f"Node {self.nodes[failure.node].name} failed (overload)")
+            else:
+                edge = self.edges[failure.line]
+                from_name = self.nodes[edge.from_node].name
+                to_name = self.nodes[edge.to_node].name
+                self.failure_history.append(f"Edge {from_name}-{to_name} failed (overload)")
+        return True
+    
     def redistribute_load(self, from_node: int, to_node: int, failed_load: float):
         """Redistribute load from failed edge to remaining edges"""
         for node_id in [from_node, to_node]:
@@ -0,0 +1,334 @@
+#include "grid.h"
+#include <cstdio>
+#include <filesystem>
+
+// Behaviour checks of the cascade engine, run by ctest. Each check prints
+// what differed and the program exits non-zero if any failed. Grids are
+// drawn from seeded Philox streams, so every run checks the same cases.
+
+int failures = 0;
+
+void check(bool ok, const string& what) {
+    if (ok) return;
+    cout << "FAILED: " << what << "\n";
+    failures++;
+}
+
+// Builds a grid with random ratings and loads, rejecting repeated lines
+class GridBuilder {
+private:
+    Graph grid;
+    Philox4x32 rng;
+    unordered_set<long long> keys;
+
+    double between(double lo, double hi) { return lo + (hi - lo) * rng.uniform(); }
+
+public:
+    GridBuilder(int n, uint64_t seed) : grid(n), rng(seed, 0) {
+        grid.setVerbose(false);
+        for (int i = 0; i < n; i++) {
+            double capacity = between(100, 300);
+            grid.addNode(i, "N" + to_string(i), capacity * between(0.4, 0.8), capacity);
+            // Every third node has its own generation; the rest supply their own load
+            if (i % 3 == 0) grid.setNodeGeneration(i, between(0, 2 * capacity));
+        }
+    }
+
+    int below(int n) { return min(n - 1, static_cast<int>(rng.uniform() * n)); }
+
+    void link(int u, int v) {
+        if (u == v || !keys.insert(static_cast<long long>(min(u, v)) << 32 | max(u, v)).second) return;
+        double capacity = between(50, 150);
+        grid.addEdge(u, v, capacity, capacity * between(0.3, 0.7), between(0.5, 1.5));
+    }
+
+    Graph take() { return move(grid); }
+};
+
+// Meshed grid with feeders hanging off it, so it has both cycles and cut elements
+Graph makeMeshed(int n, uint64_t seed) {
+    GridBuilder b(n, seed);
+    for (int i = 1; i < n; i++) {
+        b.link(i - 1 - b.below(min(i, 4)), i);
+        if (i % 5 != 0 && b.below(2)) b.link(i - 1 - b.below(min(i, 8)), i);
+    }
+    return b.take();
+}
+
+// Rows of a square-ish lattice, each node linked right and down
+Graph makeLattice(int n, uint64_t seed) {
+    GridBuilder b(n, seed);
+    int cols = static_cast<int>(ceil(sqrt(static_cast<double>(n))));
+    for (int i = 0; i < n; i++) {
+        if ((i + 1) % cols != 0 && i + 1 < n) b.link(i, i + 1);
+        if (i + cols < n) b.link(i, i + cols);
+    }
+    return b.take();
+}
+
+bool sameState(const GridState& a, const GridState& b) {
+    if (a.nodeLoads.size() != b.nodeLoads.size() || a.lineLoads.size() != b.lineLoads.size()) return false;
+    for (size_t i = 0; i < a.nodeLoads.size(); i++) {
+        if (a.nodeLoads[i] != b.nodeLoads[i] || a.nodeActive[i] != b.nodeActive[i]) return false;
+    }
+    for (size_t id = 0; id < a.lineLoads.size(); id++) {
+        if (a.lineLoads[id] != b.lineLoads[id] || a.lineActive[id] != b.lineActive[id]) return false;
+    }
+    return true;
+}
+
+bool sameEvents(const CascadeResult& a, const CascadeResult& b) {
+    if (a.events.size() != b.events.size()) return false;
+    for (size_t k = 0; k < a.events.size(); k++) {
+        const FailureEvent &x = a.events[k], &y = b.events[k];
+        if (x.node != y.node || x.line != y.line || x.load != y.load || x.capacity != y.capacity || x.forced != y.forced) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rolling back a cascade restores the state exactly, also from nested checkpoints
+void testRollback() {
+    Graph grid = makeMeshed(400, 1);
+    for (bool balance : {false, true}) {
+        for (bool dc : {false, true}) {
+            GridState st = grid.getState();
+            const GridState original = st;
+            CascadeOptions opt;
+            opt.loadIncreasePercent = 40;
+            opt.balanceIslands = balance;
+            opt.dcFlow = dc;
+            opt.outages.nodes = {7};
+            string name = string("rollback balance=") + (balance ? "on" : "off") + (dc ? " dc" : "");
+
+            st.checkpoint();
+            st.setLineActive(3, false);
+            st.setNodeLoad(5, 1);
+            const GridState outer = st;
+            st.checkpoint();
+            CascadeResult r = grid.runCascade(st, opt);
+            check(!r.events.empty(), name + ": the cascade failed nothing");
+            st.rollback();
+            check(sameState(st, outer), name + ": inner rollback");
+            st.rollback();
+            check(sameState(st, original), name + ": outer rollback");
+        }
+    }
+}
+
+// Each step of the island timeline matches a fresh component count after
+// replaying the failures up to it
+void testIslandTimeline() {
+    Graph grid = makeMeshed(500, 2);
+    for (bool rounds : {false, true}) {
+        for (bool balance : {false, true}) {
+            CascadeOptions opt;
+            opt.loadIncreasePercent = 35;
+            opt.rounds = rounds;
+            opt.balanceIslands = balance;
+            opt.outages.nodes = {10};
+            opt.outages.lines = {20, 40};
+            string name = string("timeline rounds=") + (rounds ? "on" : "off") + " balance=" + (balance ? "on" : "off");
+            GridState st = grid.getState();
+            CascadeResult r = grid.runCascade(st, opt);
+            check(r.events.size() > 10, name + ": too few failures to check");
+            check(r.timeline.size() == r.events.size(), name + ": one step per failure");
+            if (r.timeline.size() != r.events.size()) continue;
+
+            GridState replay = grid.getState();
+            check(r.initialIslands == static_cast<int>(grid.findComponents(replay).count()), name + ": initial islands");
+            for (size_t k = 0; k < r.events.size(); k++) {
+                const FailureEvent& ev = r.events[k];
+                if (ev.line == -1) {
+                    replay.setNodeActive(ev.node, false);
+                } else {
+                    replay.setLineActive(ev.line, false);
+                }
+                ComponentLabels cc = grid.findComponents(replay);
+                int largest = 0;
+                for (size_t c = 0; c < cc.count(); c++) largest = max(largest, cc.size(c));
+
+                // The islands the failure split apart: those holding the
+                // live neighbours it was connected to
+                vector<int> pieces;
+                if (ev.line == -1) {
+                    vector<int> touched;
+                    for (int id = 0; id < grid.getNumLines(); id++) {
+                        const Line& l = grid.getLine(id);
+                        if (!replay.lineActive[id] || (l.from != ev.node && l.to != ev.node)) continue;
+                        int other = l.from == ev.node ? l.to : l.from;
+                        if (cc.label[other] != -1) touched.push_back(cc.label[other]);
+                    }
+                    sort(touched.begin(), touched.end());
+                    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+                    if (touched.size() >= 2) {
+                        for (int c : touched) pieces.push_back(cc.size(c));
+                    }
+                } else {
+                    const Line& l = grid.getLine(ev.line);
+                    int a = cc.label[l.from], b = cc.label[l.to];
+                    if (a != -1 && b != -1 && a != b) pieces = {cc.size(a), cc.size(b)};
+                }
+                sort(pieces.rbegin(), pieces.rend());
+
+                const IslandStep& step = r.timeline[k];
+                string at = name + ": step " + to_string(k);
+                check(step.islands == static_cast<int>(cc.count()), at + " islands");
+                check(step.largest == largest, at + " largest island");
+                check(step.pieces == pieces, at + " pieces");
+            }
+            check(r.islands.count() == grid.findComponents(replay).count(), name + ": final islands");
+        }
+    }
+}
+
+// A round-based cascade gives the same failures and loads on one thread and on many
+void testRoundsAcrossThreads() {
+    Graph grid = makeLattice(10000, 3);
+    WorkStealingPool pool(8);
+    CascadeOptions opt;
+    opt.loadIncreasePercent = 60;
+    opt.rounds = true;
+    GridState serialState = grid.getState(), pooledState = grid.getState();
+    CascadeResult serial = grid.runCascade(serialState, opt);
+    opt.pool = &pool;
+    CascadeResult pooled = grid.runCascade(pooledState, opt);
+    check(serial.events.size() > 1000, "rounds: too few failures to reach the parallel path");
+    check(sameEvents(serial, pooled), "rounds: failures differ between 1 and 8 threads");
+    check(sameState(serialState, pooledState), "rounds: final state differs between 1 and 8 threads");
+    check(serial.rounds == pooled.rounds, "rounds: round count differs between 1 and 8 threads");
+}
+
+// Monte Carlo summaries do not depend on the thread count
+void testMonteCarloAcrossThreads() {
+    Graph grid = makeMeshed(300, 4);
+    WorkStealingPool one(1), eight(8);
+    for (bool rounds : {false, true}) {
+        CascadeOptions opt;
+        opt.loadIncreasePercent = 25;
+        opt.randomLoad = true;
+        opt.seed = 99;
+        opt.rounds = rounds;
+        opt.balanceIslands = true;
+        MonteCarloSummary a = grid.runMonteCarlo(opt, 200, &one);
+        MonteCarloSummary b = grid.runMonteCarlo(opt, 200, &eight);
+        string name = string("Monte Carlo rounds=") + (rounds ? "on" : "off");
+        check(a.totalFailures > 0, name + ": no trial failed anything");
+        check(a.trials == b.trials && a.totalFailures == b.totalFailures && a.islandedTrials == b.islandedTrials
+                  && a.sheddingTrials == b.sheddingTrials && a.blackoutTrials == b.blackoutTrials,
+              name + ": totals differ between 1 and 8 threads");
+        auto same = [](const vector<ElementStats>& x, const vector<ElementStats>& y) {
+            if (x.size() != y.size()) return false;
+            for (size_t i = 0; i < x.size(); i++) {
+                if (x[i].failures != y[i].failures || x[i].cascadeSizeSum != y[i].cascadeSizeSum
+                    || x[i].islanded != y[i].islanded) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        check(same(a.nodes, b.nodes) && same(a.lines, b.lines), name + ": element statistics differ between 1 and 8 threads");
+    }
+}
+
+// Cut elements found in one DFS match removing each element in turn and counting islands
+void testCriticalAgainstBruteForce() {
+    vector<pair<string, Graph>> grids;
+    grids.emplace_back("meshed", makeMeshed(200, 5));
+    grids.emplace_back("lattice", makeLattice(49, 6));
+    // Two islands from the start: every element is critical
+    GridBuilder split(12, 7);
+    for (int i = 1; i < 12; i++) {
+        if (i != 6) split.link(i - 1, i);
+    }
+    split.link(0, 5);
+    grids.emplace_back("split", split.take());
+    for (auto& [name, grid] : grids) {
+        WorkStealingPool pool(4);
+        CriticalReport report = grid.analyzeCriticalComponents(&pool);
+        const GridState& base = grid.getState();
+
+        vector<int> nodes;
+        for (int i = 0; i < grid.getNumNodes(); i++) {
+            GridState st = base;
+            st.setNodeActive(i, false);
+            if (grid.findComponents(st).count() > 1) nodes.push_back(i);
+        }
+        check(report.nodes == nodes, name + ": critical nodes differ from removing each node");
+
+        vector<int> cuts, reported;
+        for (int id = 0; id < grid.getNumLines(); id++) {
+            GridState st = base;
+            st.setLineActive(id, false);
+            if (grid.findComponents(st).count() > 1) cuts.push_back(id);
+        }
+        for (const CriticalLine& c : report.lines) {
+            if (c.disconnects) reported.push_back(c.line);
+        }
+        check(reported == cuts, name + ": disconnecting lines differ from removing each line");
+        if (name == "meshed") check(!cuts.empty() && static_cast<int>(cuts.size()) < grid.getNumLines(), name + ": expected both bridges and meshed lines");
+    }
+}
+
+string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// Saving a grid as text or as a snapshot and loading it back keeps every
+// rating, load and generation, including which nodes supply their own load
+void testSaveAndLoad() {
+    Graph grid = makeMeshed(300, 8);
+    filesystem::path dir = filesystem::temp_directory_path();
+    string tag = "grid_tests_" + to_string(chrono::steady_clock::now().time_since_epoch().count());
+    string text = (dir / (tag + ".txt")).string(), again = (dir / (tag + "_again.txt")).string();
+    string snapshot = (dir / (tag + ".snap")).string(), fromSnapshot = (dir / (tag + "_snap.txt")).string();
+
+    check(grid.saveGrid(text), "save text");
+    check(grid.saveSnapshot(snapshot), "save snapshot");
+    for (const string& path : {text, snapshot}) {
+        Graph loaded(1);
+        loaded.setVerbose(false);
+        check(loaded.loadGrid(path), "load " + path);
+        string name = path == text ? "text" : "snapshot";
+        check(loaded.getNumNodes() == grid.getNumNodes() && loaded.getNumLines() == grid.getNumLines(), name + ": size");
+        if (loaded.getNumNodes() != grid.getNumNodes() || loaded.getNumLines() != grid.getNumLines()) continue;
+        const GridState &a = grid.getState(), &b = loaded.getState();
+        bool nodesMatch = true, linesMatch = true;
+        for (int i = 0; i < grid.getNumNodes(); i++) {
+            nodesMatch = nodesMatch && loaded.getNodeName(i) == grid.getNodeName(i) && b.nodeLoads[i] == a.nodeLoads[i]
+                         && loaded.getNodeCapacity(i) == grid.getNodeCapacity(i)
+                         && loaded.getNodeGeneration(i) == grid.getNodeGeneration(i);
+        }
+        // The text format lists lines by endpoint, so their IDs may change
+        for (int id = 0; id < grid.getNumLines(); id++) {
+            const Line& l = grid.getLine(id);
+            int other = loaded.findLine(l.from, l.to);
+            linesMatch = linesMatch && other != -1 && b.lineLoads[other] == a.lineLoads[id]
+                         && loaded.getLineCapacity(other) == grid.getLineCapacity(id)
+                         && loaded.getLine(other).reactance == l.reactance;
+        }
+        check(nodesMatch, name + ": node data");
+        check(linesMatch, name + ": line data");
+        check(loaded.saveGrid(path == text ? again : fromSnapshot), name + ": save again");
+    }
+    check(readFile(again) == readFile(text), "text: saving a loaded text grid changes it");
+    check(readFile(fromSnapshot) == readFile(text), "snapshot: saving a loaded snapshot as text differs");
+    for (const string& path : {text, again, snapshot, fromSnapshot}) filesystem::remove(path);
+}
+
+int main() {
+    testRollback();
+    testIslandTimeline();
+    testRoundsAcrossThreads();
+    testMonteCarloAcrossThreads();
+    testCriticalAgainstBruteForce();
+    testSaveAndLoad();
+    if (failures) {
+        cout << failures << " check(s) failed\n";
+        return 1;
+    }
+    cout << "All checks passed\n";
+    return 0;
+}
@@ -1,680 +1,13 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <string>
-#include <limits>
-#include <map>
-#include <set>
-#include <fstream>
-#include <random>
-#include <iomanip>
-#include <ctime>
-#include <sstream>
-
-using namespace std;
-
-// Structure to represent an edge (transmission line)
-struct Edge {
-    int to; // Destination node
-    double capacity; // Max capacity in MW
-    double currentLoad; // Current load in MW
-    bool active; // Is the edge operational?
-};
-
-// Structure to represent a node (substation)
-struct Node {
-    string name; // Node identifier
-    double load; // Current power demand in MW
-    double maxCapacity; // Max capacity in MW
-    bool active; // Is the node operational?
-};
-
-// Union-Find for connectivity
-class UnionFind {
-private:
-    vector<int> parent, rank;
-public:
-    UnionFind(int n) : parent(n), rank(n, 0) {
-        for (int i = 0; i < n; i++) parent[i] = i;
-    }
-    int find(int x) {
-        if (x < 0 || x >= static_cast<int>(parent.size())) return -1;
-        if (parent[x] != x) parent[x] = find(parent[x]);
-        return parent[x];
-    }
-    int find(int x) const {
-        if (x < 0 || x >= static_cast<int>(parent.size())) return -1;
-        if (parent[x] == x) return x;
-        return find(parent[x]);
-    }
-    void unite(int x, int y) {
-        int px = find(x), py = find(y);
-        if (px == py || px == -1 || py == -1) return;
-        if (rank[px] < rank[py]) parent[px] = py;
-        else if (rank[px] > rank[py]) parent[py] = px;
-        else {
-            parent[py] = px;
-            rank[px]++;
-        }
-    }
-    bool connected(int x, int y) const {
-        return find(x) == find(y);
-    }
-};
-
-// Structure to store grid state for backup
-struct GridState {
-    vector<bool> nodeActive;
-    vector<double> nodeLoads;
-    vector<vector<bool>> edgeActive;
-    vector<vector<double>> edgeLoads;
-};
-
-// Graph class to represent the electric grid
-class Graph {
-private:
-    vector<Node> nodes; // List of nodes
-    vector<vector<Edge>> adj; // Adjacency list for edges
-    int numNodes;
-    map<pair<int, int>, pair<int, int>> edgeIndex; // Map (u,v) to (index in adj[u], index in adj[v])
-    default_random_engine rng; // For random load variations
-
-    // DFS to collect component nodes
-    void DFS(int v, vector<bool>& visited, vector<int>& component) const {
-        if (v < 0 || v >= numNodes) return; // Ensure valid node index
-        visited[v] = true;
-        component.push_back(v);
-        for (const Edge& e : adj[v]) {
-            if (e.active && nodes[e.to].active && !visited[e.to]) {
-                DFS(e.to, visited, component);
-            }
-        }
-    }
-
-    // Save current grid state
-    GridState saveState() const {
-        GridState state;
-        state.nodeActive.resize(numNodes);
-        state.nodeLoads.resize(numNodes);
-        state.edgeActive.resize(numNodes);
-        state.edgeLoads.resize(numNodes);
-        for (int i = 0; i < numNodes; i++) {
-            state.nodeActive[i] = nodes[i].active;
-            state.nodeLoads[i] = nodes[i].load;
-            state.edgeActive[i].resize(adj[i].size());
-            state.edgeLoads[i].resize(adj[i].size());
-            for (size_t j = 0; j < adj[i].size(); j++) {
-                state.edgeActive[i][j] = adj[i][j].active;
-                state.edgeLoads[i][j] = adj[i][j].currentLoad;
-            }
-        }
-        return state;
-    }
-
-    // Restore grid state
-    void restoreState(const GridState& state) {
-        for (int i = 0; i < numNodes && i < static_cast<int>(state.nodeActive.size()); i++) {
-            nodes[i].active = state.nodeActive[i];
-            nodes[i].load = state.nodeLoads[i];
-            if (i < static_cast<int>(state.edgeActive.size()) && adj[i].size() == state.edgeActive[i].size()) {
-                for (size_t j = 0; j < adj[i].size(); j++) {
-                    adj[i][j].active = state.edgeActive[i][j];
-                    adj[i][j].currentLoad = state.edgeLoads[i][j];
-                }
-            }
-        }
-    }
+#include "grid.h"
 
-public:
-    Graph(int n) : numNodes(n), rng() {
-        nodes.resize(n, {"", 0.0, 0.0, true});
-        adj.resize(n);
-        // Explicitly seed rng for reproducibility
-        rng.seed(static_cast<unsigned>(time(nullptr)));
-    }
-
-    // Add a node (substation)
-    bool addNode(int idx, const string& name, double load, double maxCapacity) {
-        if (idx < 0 || idx >= numNodes) {
-            cout << "Invalid node index: " << idx << ". Must be between 0 and " << (numNodes - 1) << ".\n";
-            return false;
-        }
-        if (load < 0) {
-            cout << "Invalid load for node " << name << ". Load must be >= 0.\n";
-            return false;
-        }
-        if (maxCapacity <= 0) {
-            cout << "Invalid max capacity for node " << name << ". Max capacity must be > 0.\n";
-            return false;
-        }
-        if (load > maxCapacity) {
-            cout << "Invalid load for node " << name << ". Load must be <= max capacity (" << maxCapacity << ").\n";
-            return false;
-        }
-        nodes[idx] = {name, load, maxCapacity, true};
-        return true;
-    }
-
-    // Add an edge (transmission line)
-    bool addEdge(int from, int to, double capacity, double currentLoad) {
-        if (from < 0 || from >= numNodes || to < 0 || to >= numNodes) {
-            cout << "Invalid node index: " << from << " or " << to << ". Must be between 0 and " << (numNodes - 1) << ".\n";
-            return false;
-        }
-        if (from == to) {
-            cout << "Self-loops are not allowed: " << from << " to " << to << ".\n";
-            return false;
-        }
-        if (capacity <= 0) {
-            cout << "Invalid capacity for edge " << from << "-" << to << ". Capacity must be > 0.\n";
-            return false;
-        }
-        if (currentLoad < 0) {
-            cout << "Invalid load for edge " << from << "-" << to << ". Load must be >= 0.\n";
-            return false;
-        }
-        pair<int, int> edge = {min(from, to), max(from, to)};
-        if (edgeIndex.find(edge) != edgeIndex.end()) {
-            cout << "Duplicate edge between " << from << " and " << to << ".\n";
-            return false;
-        }
-        adj[from].push_back({to, capacity, currentLoad, true});
-        adj[to].push_back({from, capacity, currentLoad, true});
-        edgeIndex[edge] = {static_cast<int>(adj[from].size()) - 1, static_cast<int>(adj[to].size()) - 1};
-        return true;
-    }
-
-    // Check if the grid is connected using Union-Find
-    bool isConnected() const {
-        UnionFind uf(numNodes);
-        for (int u = 0; u < numNodes; u++) {
-            if (!nodes[u].active) continue;
-            for (const Edge& e : adj[u]) {
-                if (e.active && nodes[e.to].active) {
-                    uf.unite(u, e.to);
-                }
-            }
-        }
-        int root = -1;
-        for (int i = 0; i < numNodes; i++) {
-            if (nodes[i].active) {
-                root = uf.find(i);
-                break;
-            }
-        }
-        if (root == -1) return true; // Empty grid
-        for (int i = 0; i < numNodes; i++) {
-            if (nodes[i].active && uf.find(i) != root) return false;
-        }
-        return true;
-    }
-
-    // Find connected components
-    vector<vector<int>> findComponents() const {
-        vector<bool> visited(numNodes, false);
-        vector<vector<int>> components;
-        for (int i = 0; i < numNodes; i++) {
-            if (!visited[i] && nodes[i].active) {
-                vector<int> component;
-                DFS(i, visited, component);
-                components.push_back(component);
-            }
-        }
-        return components;
-    }
-
-    // Check for overloaded nodes or edges
-    void checkOverloads(vector<string>& overloadedNodes, vector<pair<int, int>>& overloadedEdges) const {
-        overloadedNodes.clear();
-        overloadedEdges.clear();
-        for (int i = 0; i < numNodes; i++) {
-            if (nodes[i].active && nodes[i].load >= nodes[i].maxCapacity) {
-                overloadedNodes.push_back(nodes[i].name);
-            }
-        }
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (e.active && e.currentLoad >= e.capacity && seenEdges.find(edge) == seenEdges.end()) {
-                    overloadedEdges.push_back({u, e.to});
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-    }
-
-    // Simulate cascading failures
-    void simulateCascadingFailures(double loadIncreasePercent, bool randomLoad) {
-        if (loadIncreasePercent < 0) {
-            cout << "Load increase percentage must be >= 0.\n";
-            return;
-        }
-        cout << "\nSimulating load increase by " << loadIncreasePercent << "% "
-             << (randomLoad ? "with random variations" : "uniformly") << "\n";
-
-        // Backup state
-        GridState originalState = saveState();
-
-        // Apply load increase
-        uniform_real_distribution<double> dist(0.5, 1.5); // Random factor 50%-150%
-        for (int i = 0; i < numNodes; i++) {
-            if (nodes[i].active) {
-                double factor = randomLoad ? dist(rng) : 1.0;
-                double oldLoad = nodes[i].load;
-                nodes[i].load *= (1 + loadIncreasePercent / 100.0 * factor);
-                cout << "Node " << nodes[i].name << ": Load increased from " << fixed << setprecision(2)
-                     << oldLoad << " to " << nodes[i].load << " MW (factor = " << factor << ")\n";
-            }
-        }
-        for (int u = 0; u < numNodes; u++) {
-            for (Edge& e : adj[u]) {
-                if (e.active) {
-                    double factor = randomLoad ? dist(rng) : 1.0;
-                    double oldLoad = e.currentLoad;
-                    e.currentLoad *= (1 + loadIncreasePercent / 100.0 * factor);
-                    cout << "Edge " << nodes[u].name << "-" << nodes[e.to].name << ": Load increased from "
-                         << oldLoad << " to " << e.currentLoad << " MW (factor = " << factor << ")\n";
-                }
-            }
-        }
-
-        // Simulate cascading failures
-        priority_queue<pair<double, pair<int, int>>, vector<pair<double, pair<int, int>>>, greater<>> pq;
-        vector<string> overloadedNodes;
-        vector<pair<int, int>> overloadedEdges;
-        checkOverloads(overloadedNodes, overloadedEdges);
-        cout << "Initial Overloaded Nodes: " << overloadedNodes.size() << ", Overloaded Edges: " << overloadedEdges.size() << "\n";
-        for (const string& name : overloadedNodes) {
-            for (int i = 0; i < numNodes; i++) {
-                if (nodes[i].name == name && nodes[i].active) {
-                    pq.push({nodes[i].load / nodes[i].maxCapacity, {i, -1}});
-                    break;
-                }
-            }
-        }
-        for (const auto& e : overloadedEdges) {
-            for (const Edge& edge : adj[e.first]) {
-                if (edge.to == e.second && edge.active) {
-                    pq.push({edge.currentLoad / edge.capacity, {e.first, e.second}});
-                    break;
-                }
-            }
-        }
-
-        // Process failures
-        while (!pq.empty()) {
-            double severity = pq.top().first;
-            pair<int, int> p = pq.top().second;
-            pq.pop();
-            int u = p.first, v = p.second;
-
-            if (v == -1) { // Node failure
-                if (u < 0 || u >= numNodes || !nodes[u].active) continue; // Skip if already failed or invalid
-                nodes[u].active = false;
-                cout << "Node " << nodes[u].name << " failed (load = " << fixed << setprecision(2)
-                     << nodes[u].load << " MW, capacity = " << nodes[u].maxCapacity << " MW)\n";
-            } else { // Edge failure
-                pair<int, int> edge = {min(u, v), max(u, v)};
-                auto it = edgeIndex.find(edge);
-                if (it == edgeIndex.end()) continue;
-                int idx_u = it->second.first, idx_v = it->second.second;
-                if (idx_u >= static_cast<int>(adj[u].size()) || !adj[u][idx_u].active) continue;
-                double failedLoad = adj[u][idx_u].currentLoad;
-                adj[u][idx_u].active = false;
-                if (idx_v < static_cast<int>(adj[v].size())) {
-                    adj[v][idx_v].active = false;
-                }
-                cout << "Edge " << nodes[u].name << "-" << nodes[v].name << " failed (load = "
-                     << failedLoad << " MW, capacity = " << adj[u][idx_u].capacity << " MW)\n";
-                redistributeLoad(u, v, failedLoad);
-            }
-
-            // Recheck overloads
-            checkOverloads(overloadedNodes, overloadedEdges);
-            cout << "Rechecked Overloaded Nodes: " << overloadedNodes.size() << ", Overloaded Edges: " << overloadedEdges.size() << "\n";
-            for (const string& name : overloadedNodes) {
-                for (int i = 0; i < numNodes; i++) {
-                    if (nodes[i].name == name && nodes[i].active) {
-                        pq.push({nodes[i].load / nodes[i].maxCapacity, {i, -1}});
-                        break;
-                    }
-                }
-            }
-            for (const auto& e : overloadedEdges) {
-                for (const Edge& edge : adj[e.first]) {
-                    if (edge.to == e.second && edge.active) {
-                        pq.push({edge.currentLoad / edge.capacity, {e.first, e.second}});
-                        break;
-                    }
-                }
-            }
-        }
-
-        // Report final state
-        reportGridState();
-        saveGridVisualization("grid.dot");
-
-        // Restore state
-        restoreState(originalState);
-    }
-
-    // Redistribute load after edge failure
-    void redistributeLoad(int u, int v, double failedLoad) {
-        for (int i : {u, v}) {
-            if (i < 0 || i >= numNodes) continue; // Ensure valid node index
-            double totalCapacity = 0.0;
-            vector<Edge*> activeEdges;
-            for (Edge& e : adj[i]) {
-                if (e.active && nodes[e.to].active && e.currentLoad < e.capacity) {
-                    totalCapacity += e.capacity - e.currentLoad;
-                    activeEdges.push_back(&e);
-                }
-            }
-            if (totalCapacity <= 0 || activeEdges.empty()) {
-                cout << "Warning: No available capacity to redistribute load from node " << nodes[i].name << "\n";
-                continue;
-            }
-            double loadPerCapacity = failedLoad / totalCapacity;
-            for (Edge* e : activeEdges) {
-                double additionalLoad = loadPerCapacity * (e->capacity - e->currentLoad);
-                e->currentLoad += additionalLoad;
-                cout << "Redistributed " << fixed << setprecision(2) << additionalLoad << " MW to edge "
-                     << nodes[i].name << "-" << nodes[e->to].name << "\n";
-            }
-        }
-    }
-
-    // Identify critical nodes and edges
-    void identifyCriticalComponents() {
-        cout << "\nCritical Component Analysis:\n";
-        GridState originalState = saveState();
-
-        // Test each node
-        cout << "Critical Nodes (failure disconnects grid):\n";
-        for (int i = 0; i < numNodes; i++) {
-            if (!nodes[i].active) continue;
-            nodes[i].active = false;
-            if (!isConnected()) {
-                cout << "- " << nodes[i].name << ": Failure disconnects grid\n";
-            }
-            nodes[i].active = true;
-        }
-
-        // Test each edge
-        cout << "Critical Edges (failure causes overloads or disconnection):\n";
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (u < e.to && e.active && seenEdges.find(edge) == seenEdges.end()) {
-                    seenEdges.insert(edge);
-                    auto it = edgeIndex.find(edge);
-                    if (it == edgeIndex.end()) continue;
-                    int idx_u = it->second.first, idx_v = it->second.second;
-                    if (idx_u >= static_cast<int>(adj[u].size()) || idx_v >= static_cast<int>(adj[e.to].size())) continue;
-                    double failedLoad = adj[u][idx_u].currentLoad;
-                    adj[u][idx_u].active = false;
-                    adj[e.to][idx_v].active = false;
-                    bool critical = !isConnected();
-                    if (!critical) {
-                        redistributeLoad(u, e.to, failedLoad);
-                        vector<string> overloadedNodes;
-                        vector<pair<int, int>> overloadedEdges;
-                        checkOverloads(overloadedNodes, overloadedEdges);
-                        if (!overloadedNodes.empty() || !overloadedEdges.empty()) {
-                            critical = true;
-                        }
-                    }
-                    if (critical) {
-                        cout << "- Edge " << nodes[u].name << "-" << nodes[e.to].name << ": Failure causes "
-                             << (!isConnected() ? "disconnection" : "overloads") << "\n";
-                    }
-                    adj[u][idx_u].active = true;
-                    adj[e.to][idx_v].active = true;
-                    restoreState(originalState);
-                }
-            }
-        }
-        restoreState(originalState);
-    }
-
-    // Report grid state
-    void reportGridState() const {
-        cout << "\nFinal Grid State:\n";
-        int activeNodes = 0, activeEdges = 0;
-        for (const auto& node : nodes) {
-            if (node.active) activeNodes++;
-        }
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (e.active && seenEdges.find(edge) == seenEdges.end()) {
-                    activeEdges++;
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-        cout << "Active Nodes: " << activeNodes << "/" << numNodes << "\n";
-        cout << "Active Edges: " << activeEdges << "\n";
-        if (!isConnected()) {
-            auto components = findComponents();
-            cout << "Grid is disconnected! Number of components: " << components.size() << "\n";
-            for (int i = 0; i < static_cast<int>(components.size()); i++) {
-                cout << "Component " << i + 1 << ": ";
-                for (int v : components[i]) {
-                    cout << nodes[v].name << " ";
-                }
-                cout << "\n";
-            }
-        } else {
-            cout << "Grid remains connected.\n";
-        }
-    }
-
-    // Display grid status
-    void displayGrid() const {
-        cout << "\nGrid Status:\n";
-        cout << "Nodes (Substations):\n";
-        for (int i = 0; i < numNodes; i++) {
-            cout << "Node " << nodes[i].name << ": Load = " << fixed << setprecision(2)
-                 << nodes[i].load << " MW, Max Capacity = " << nodes[i].maxCapacity
-                 << " MW, Status = " << (nodes[i].active ? "Active" : "Failed") << "\n";
-        }
-        cout << "Edges (Transmission Lines):\n";
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (u < e.to && seenEdges.find(edge) == seenEdges.end()) {
-                    cout << "Between " << nodes[u].name << " and " << nodes[e.to].name
-                         << ": Load = " << e.currentLoad << " MW, Capacity = " << e.capacity
-                         << " MW, Status = " << (e.active ? "Active" : "Failed") << "\n";
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-    }
-
-    // Save grid visualization to DOT file
-    void saveGridVisualization(const string& filename) const {
-        ofstream out(filename);
-        if (!out) {
-            cout << "Error opening file: " << filename << "\n";
-            return;
-        }
-        out << "graph G {\n";
-        out << "    rankdir=LR;\n";
-        for (int i = 0; i < numNodes; i++) {
-            out << "    " << nodes[i].name << " [label=\"" << nodes[i].name << "\\nLoad: "
-                << fixed << setprecision(2) << nodes[i].load << " MW\\nCap: " << nodes[i].maxCapacity
-                << " MW\", color=" << (nodes[i].active ? "blue" : "red") << "];\n";
-        }
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (u < e.to && seenEdges.find(edge) == seenEdges.end()) {
-                    out << "    " << nodes[u].name << " -- " << nodes[e.to].name
-                        << " [label=\"Load: " << e.currentLoad << " MW\\nCap: " << e.capacity
-                        << " MW\", color=" << (e.active ? "black" : "red") << "];\n";
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-        out << "}\n";
-        out.close();
-        cout << "Grid visualization saved to " << filename << "\n";
-    }
-
-    // Save grid to file
-    void saveGrid(const string& filename) const {
-        ofstream out(filename);
-        if (!out) {
-            cout << "Error opening file: " << filename << "\n";
-            return;
-        }
-        out << numNodes << "\n";
-        for (int i = 0; i < numNodes; i++) {
-            out << nodes[i].name << " " << fixed << setprecision(2) << nodes[i].load << " " << nodes[i].maxCapacity << "\n";
-        }
-        int edgeCount = 0;
-        set<pair<int, int>> seenEdges;
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (u < e.to && seenEdges.find(edge) == seenEdges.end()) {
-                    edgeCount++;
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-        out << edgeCount << "\n";
-        seenEdges.clear();
-        for (int u = 0; u < numNodes; u++) {
-            for (const Edge& e : adj[u]) {
-                pair<int, int> edge = {min(u, e.to), max(u, e.to)};
-                if (u < e.to && seenEdges.find(edge) == seenEdges.end()) {
-                    out << u << " " << e.to << " " << fixed << setprecision(2) << e.currentLoad << " " << e.capacity << "\n";
-                    seenEdges.insert(edge);
-                }
-            }
-        }
-        out.close();
-        cout << "Grid saved to " << filename << "\n";
-    }
-
-    // Load grid from file
-    bool loadGrid(const string& filename) {
-        ifstream in(filename);
-        if (!in) {
-            cout << "Error opening file: " << filename << "\n";
-            return false;
-        }
-        int n;
-        if (!(in >> n) || n <= 0) {
-            cout << "Invalid number of nodes in file. Must be > 0.\n";
-            in.close();
-            return false;
-        }
-        Graph newGraph(n);
-        map<string, int> nameToIndex;
-        string line;
-        getline(in, line); // Clear newline after n
-        for (int i = 0; i < n; i++) {
-            getline(in, line);
-            if (in.eof()) {
-                cout << "Unexpected end of file at line " << i + 2 << ".\n";
-                in.close();
-                return false;
-            }
-            istringstream iss(line);
-            string name;
-            double load, maxCapacity;
-            if (!(iss >> name >> load >> maxCapacity) || name.empty()) {
-                cout << "Invalid node data at line " << i + 2 << ". Expected: name load maxCapacity.\n";
-                in.close();
-                return false;
-            }
-            if (load < 0) {
-                cout << "Invalid load at line " << i + 2 << ". Load must be >= 0.\n";
-                in.close();
-                return false;
-            }
-            if (maxCapacity <= 0) {
-                cout << "Invalid max capacity at line " << i + 2 << ". Max capacity must be > 0.\n";
-                in.close();
-                return false;
-            }
-            if (load > maxCapacity) {
-                cout << "Invalid load at line " << i + 2 << ". Load must be <= max capacity.\n";
-                in.close();
-                return false;
-            }
-            if (!newGraph.addNode(i, name, load, maxCapacity)) {
-                in.close();
-                return false;
-            }
-            nameToIndex[name] = i;
-        }
-        int m;
-        if (!(in >> m) || m < 0) {
-            cout << "Invalid number of edges in file. Must be >= 0.\n";
-            in.close();
-            return false;
-        }
-        getline(in, line); // Clear newline after m
-        for (int i = 0; i < m; i++) {
-            getline(in, line);
-            if (in.eof() && i < m) {
-                cout << "Unexpected end of file at line " << i + n + 3 << ".\n";
-                in.close();
-                return false;
-            }
-            istringstream iss(line);
-            int u, v;
-            double load, capacity;
-            if (!(iss >> u >> v >> load >> capacity)) {
-                cout << "Invalid edge data at line " << i + n + 3 << ". Expected: u v load capacity.\n";
-                in.close();
-                return false;
-            }
-            if (u < 0 || u >= n || v < 0 || v >= n) {
-                cout << "Invalid node indices at line " << i + n + 3 << ". Indices must be between 0 and " << n - 1 << ".\n";
-                in.close();
-                return false;
-            }
-            if (load < 0) {
-                cout << "Invalid load at line " << i + n + 3 << ". Load must be >= 0.\n";
-                in.close();
-                return false;
-            }
-            if (capacity <= 0) {
-                cout << "Invalid capacity at line " << i + n + 3 << ". Capacity must be > 0.\n";
-                in.close();
-                return false;
-            }
-            if (!newGraph.addEdge(u, v, capacity, load)) {
-                in.close();
-                return false;
-            }
-        }
-        in.close();
-        edgeIndex.clear(); // Clear edgeIndex before assigning new graph
-        *this = move(newGraph); // Use move to avoid unnecessary copying
-        cout << "Grid loaded from " << filename << "\n";
-        return true;
-    }
-
-    // Getter for node name
-    string getNodeName(int idx) const {
-        if (idx >= 0 && idx < numNodes) {
-            return nodes[idx].name;
-        }
-        return "Unknown";
-    }
-};
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <cerrno>
+#endif
 
 // Interactive menu
 void runInteractive(Graph& grid) {
@@ -703,22 +36,23 @@ void runInteractive(Graph& grid) {
                 grid.saveGridVisualization("grid.dot");
                 break;
             case 2: {
-                vector<string> overloadedNodes;
-                vector<pair<int, int>> overloadedEdges;
-                grid.checkOverloads(overloadedNodes, overloadedEdges);
-                if (!overloadedNodes.empty() || !overloadedEdges.empty()) {
+                vector<int> overloadedNodes;
+                vector<int> overloadedLines;
+                grid.checkOverloads(overloadedNodes, overloadedLines);
+                if (!overloadedNodes.empty() || !overloadedLines.empty()) {
                     cout << "\nOverloads Detected:\n";
                     if (!overloadedNodes.empty()) {
                         cout << "Overloaded Nodes:\n";
-                        for (const string& name : overloadedNodes) {
-                            cout << "- " << name << "\n";
+                        for (int i : overloadedNodes) {
+                            cout << "- " << grid.getNodeName(i) << "\n";
                         }
                     }
-                    if (!overloadedEdges.empty()) {
+                    if (!overloadedLines.empty()) {
                         cout << "Overloaded Transmission Lines:\n";
-                        for (const auto& e : overloadedEdges) {
-                            cout << "- Between " << grid.getNodeName(e.first) << " and "
-                                 << grid.getNodeName(e.second) << "\n";
+                        for (int id : overloadedLines) {
+                            const Line& l = grid.getLine(id);
+                            cout << "- Between " << grid.getNodeName(min(l.from, l.to)) << " and "
+                                 << grid.getNodeName(max(l.from, l.to)) << "\n";
                         }
                     }
                 } else {
@@ -754,7 +88,7 @@ void runInteractive(Graph& grid) {
                 break;
             }
             case 5:
-                grid.identifyCriticalComponents();
+                grid.identifyCriticalComponents(&defaultPool());
                 break;
             case 6: {
                 string filename;
@@ -787,8 +121,1416 @@ void runInteractive(Graph& grid) {
     }
 }
 
+// One run listed in a batch scenario file
+struct Scenario {
+    string name;
+    double loadIncreasePercent = 0.0;
+    bool randomLoad = false;
+    unsigned seed = 0;
+    bool dcFlow = false; // flow=dc
+    bool rounds = false; // cascade=rounds
+    bool balance = false; // balance=on
+    BasicContingency<long long> outages; // Wide enough for any preset; checked against the grid
+};
+
+// Parse a comma-separated list of integers, e.g. "2,5,7"
+bool parseIndexList(const string& text, vector<long long>& out) {
+    istringstream iss(text);
+    string item;
+    while (getline(iss, item, ',')) {
+        istringstream is(item);
+        long long idx;
+        if (!(is >> idx) || !is.eof()) return false;
+        out.push_back(idx);
+    }
+    return !out.empty();
+}
+
+// Parse a comma-separated list of lines, e.g. "0-1,2-3", into line IDs
+template <typename G>
+bool parseLineList(const string& text, const G& grid, vector<long long>& out) {
+    istringstream iss(text);
+    string item;
+    while (getline(iss, item, ',')) {
+        size_t dash = item.find('-');
+        if (dash == string::npos) return false;
+        vector<long long> ends;
+        if (!parseIndexList(item.substr(0, dash), ends) || !parseIndexList(item.substr(dash + 1), ends)) return false;
+        if (ends[0] < 0 || ends[0] >= grid.getNumNodes() || ends[1] < 0 || ends[1] >= grid.getNumNodes()) return false;
+        long long id = grid.findLine(ends[0], ends[1]);
+        if (id < 0) return false;
+        out.push_back(id);
+    }
+    return !out.empty();
+}
+
+// Parse scenarios, one per line: name uniform|random percent [seed=N] [nodes=i,...] [lines=u-v,...]
+template <typename G>
+bool parseScenarios(istream& in, const G& grid, bool dcFlow, bool rounds, bool balance, vector<Scenario>& scenarios,
+                    ostream& err = cout) {
+    string line;
+    int lineNo = 0;
+    while (getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream iss(line);
+        Scenario sc;
+        string mode;
+        if (!(iss >> sc.name)) continue; // Blank or comment line
+        if (!(iss >> mode >> sc.loadIncreasePercent) || (mode != "uniform" && mode != "random")) {
+            err << "Invalid scenario at line " << lineNo << ". Expected: name uniform|random percent [options].\n";
+            return false;
+        }
+        if (sc.loadIncreasePercent < 0) {
+            err << "Invalid load increase at line " << lineNo << ". Percentage must be >= 0.\n";
+            return false;
+        }
+        sc.randomLoad = (mode == "random");
+        sc.seed = static_cast<unsigned>(lineNo); // Reproducible default
+        sc.dcFlow = dcFlow;
+        sc.rounds = rounds;
+        sc.balance = balance;
+        string opt;
+        while (iss >> opt) {
+            size_t eq = opt.find('=');
+            string key = opt.substr(0, eq), value = eq == string::npos ? "" : opt.substr(eq + 1);
+            bool ok = false;
+            if (key == "seed") {
+                istringstream is(value);
+                ok = static_cast<bool>(is >> sc.seed) && is.eof();
+            } else if (key == "nodes") {
+                ok = parseIndexList(value, sc.outages.nodes);
+                for (long long i : sc.outages.nodes) ok = ok && i >= 0 && i < grid.getNumNodes();
+            } else if (key == "lines") {
+                ok = parseLineList(value, grid, sc.outages.lines);
+            } else if (key == "flow") {
+                ok = value == "dc" || value == "local";
+                sc.dcFlow = value == "dc";
+            } else if (key == "cascade") {
+                ok = value == "rounds" || value == "serial";
+                sc.rounds = value == "rounds";
+            } else if (key == "balance") {
+                ok = value == "on" || value == "off";
+                sc.balance = value == "on";
+            }
+            if (!ok) {
+                err << "Invalid option '" << opt << "' at line " << lineNo << ".\n";
+                return false;
+            }
+        }
+        scenarios.push_back(sc);
+    }
+    return true;
+}
+
+// Load a scenario file
+template <typename G>
+bool loadScenarios(const string& filename, const G& grid, bool dcFlow, bool rounds, bool balance,
+                   vector<Scenario>& scenarios) {
+    ifstream in(filename);
+    if (!in) {
+        cout << "Error opening file: " << filename << "\n";
+        return false;
+    }
+    return parseScenarios(in, grid, dcFlow, rounds, balance, scenarios);
+}
+
+// Escape a string for a JSON string literal
+string jsonEscape(const string& text) {
+    string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+// Write the failures and final state of a cascade as the closing JSON fields of a result
+template <typename G>
+void writeCascade(ostream& out, const G& grid, const typename G::CascadeResult& r) {
+    string failedNodes, failedLines;
+    for (const auto& ev : r.events) {
+        if (ev.line == -1) {
+            failedNodes += (failedNodes.empty() ? "" : ",") + to_string(ev.node);
+        } else {
+            const auto& l = grid.getLine(ev.line);
+            failedLines += (failedLines.empty() ? "[" : ",[") + to_string(l.from) + "," + to_string(l.to) + "]";
+        }
+    }
+    int activeNodes = 0, activeLines = 0;
+    for (bool a : r.nodeActive) activeNodes += a;
+    for (bool a : r.lineActive) activeLines += a;
+    string islanding; // Empty if the cascade ran without islandTimeline
+    for (size_t k = 0; k < min(r.events.size(), r.timeline.size()); k++) {
+        const auto& step = r.timeline[k];
+        if (step.pieces.empty()) continue;
+        const auto& ev = r.events[k];
+        islanding += islanding.empty() ? "{" : ",{";
+        if (ev.line == -1) {
+            islanding += "\"node\":" + to_string(ev.node);
+        } else {
+            const auto& l = grid.getLine(ev.line);
+            islanding += "\"line\":[" + to_string(l.from) + "," + to_string(l.to) + "]";
+        }
+        islanding += ",\"islands\":" + to_string(step.islands) + ",\"sizes\":[";
+        for (size_t p = 0; p < step.pieces.size(); p++) islanding += (p ? "," : "") + to_string(step.pieces[p]);
+        islanding += "]}";
+    }
+    out << ",\"failed_nodes\":[" << failedNodes << "],\"failed_lines\":[" << failedLines
+        << "],\"active_nodes\":" << activeNodes << ",\"active_lines\":" << activeLines
+        << ",\"components\":" << r.islands.count() << ",\"islanding\":[" << islanding << "]";
+    if (r.rounds > 0) out << ",\"rounds\":" << r.rounds;
+    if (!r.balance.empty()) {
+        // Totals over all islands, then the islands that shed load
+        double generation = 0, demand = 0, shed = 0;
+        int blackouts = 0;
+        string shedding;
+        for (size_t c = 0; c < r.balance.size(); c++) {
+            const IslandBalance& b = r.balance[c];
+            generation += b.generation;
+            demand += b.demand;
+            shed += b.shed;
+            blackouts += b.blackout;
+            if (b.shed <= 0) continue;
+            shedding += (shedding.empty() ? "{\"island\":" : ",{\"island\":") + to_string(c)
+                        + ",\"nodes\":" + to_string(r.islands.size(c)) + ",\"generation\":" + formatNumber(b.generation)
+                        + ",\"demand\":" + formatNumber(b.demand) + ",\"shed\":" + formatNumber(b.shed)
+                        + ",\"stages\":" + to_string(b.stages) + ",\"blackout\":" + (b.blackout ? "true" : "false") + "}";
+        }
+        out << ",\"balance\":{\"generation\":" << formatNumber(generation) << ",\"demand\":" << formatNumber(demand)
+            << ",\"shed\":" << formatNumber(shed) << ",\"transferred\":" << formatNumber(r.transferredDemand)
+            << ",\"dropped\":" << formatNumber(r.droppedDemand) << ",\"blackouts\":" << blackouts
+            << ",\"shedding\":[" << shedding << "]}";
+    }
+    out << "}\n";
+}
+
+// Write one scenario result as a JSON object on a single line
+template <typename G>
+void writeResult(ostream& out, const G& grid, const Scenario& sc, const typename G::CascadeResult& r) {
+    out << "{\"scenario\":\"" << jsonEscape(sc.name) << "\",\"mode\":\""
+        << (sc.randomLoad ? "random" : "uniform") << "\",\"percent\":" << sc.loadIncreasePercent;
+    if (sc.randomLoad) out << ",\"seed\":" << sc.seed;
+    if (sc.dcFlow) out << ",\"flow\":\"dc\"";
+    if (sc.rounds) out << ",\"cascade\":\"rounds\"";
+    writeCascade(out, grid, r);
+}
+
+// Results stream of a mode. It passes writes straight on to the file or to
+// stdout, counting the bytes for the metrics.
+class ModeOutput : private streambuf {
+private:
+    streambuf* target = nullptr;
+
+    int overflow(int c) override {
+        if (c == EOF) return 0;
+        GRID_COUNT(BytesWritten, 1);
+        return target->sputc(static_cast<char>(c));
+    }
+    streamsize xsputn(const char* s, streamsize n) override {
+        GRID_COUNT(BytesWritten, n);
+        return target->sputn(s, n);
+    }
+    int sync() override { return target->pubsync(); }
+
+public:
+    ofstream file;
+    ostream stream;
+
+    ModeOutput() : stream(this) {}
+
+    ostream* attach(streambuf* to) {
+        target = to;
+        return &stream;
+    }
+};
+
+// Open the output file, or fall back to stdout when no file is given
+ostream* openOutput(const string& outFile, ModeOutput& output) {
+    if (outFile.empty()) return output.attach(cout.rdbuf());
+    output.file.open(outFile);
+    if (!output.file) {
+        cout << "Error opening file: " << outFile << "\n";
+        return nullptr;
+    }
+    return output.attach(output.file.rdbuf());
+}
+
+// Cascade options for a scenario on engine G
+template <typename G>
+typename G::CascadeOptions scenarioOptions(const Scenario& sc) {
+    typename G::CascadeOptions options;
+    options.loadIncreasePercent = sc.loadIncreasePercent;
+    options.randomLoad = sc.randomLoad;
+    options.seed = sc.seed;
+    options.dcFlow = sc.dcFlow;
+    options.rounds = sc.rounds;
+    options.balanceIslands = sc.balance;
+    options.outages.nodes.assign(sc.outages.nodes.begin(), sc.outages.nodes.end());
+    options.outages.lines.assign(sc.outages.lines.begin(), sc.outages.lines.end());
+    return options;
+}
+
+// Run every scenario against one in-memory grid and write JSON Lines results
+template <typename G>
+int runBatch(const string& gridFile, const string& scenarioFile, bool dcFlow, bool rounds, bool balance,
+             unsigned threads, const string& outFile, const string& traceFile) {
+    G grid(1);
+    grid.setVerbose(false);
+    if (!grid.loadGrid(gridFile)) return 1;
+    vector<Scenario> scenarios;
+    if (!loadScenarios(scenarioFile, grid, dcFlow, rounds, balance, scenarios)) return 1;
+
+    ModeOutput file;
+    ostream* out = openOutput(outFile, file);
+    if (!out) return 1;
+    TraceWriter trace;
+    BasicTraceObserver<typename G::IndexType> tracer(trace);
+    if (!traceFile.empty() && !trace.open(traceFile, grid.getNumNodes(), grid.getNumLines())) return 1;
+    // Scenarios run one at a time, so round-based ones can spread each round
+    // over a pool, and balanced ones their islands
+    unique_ptr<WorkStealingPool> pool;
+    for (const Scenario& sc : scenarios) {
+        typename G::CascadeOptions options = scenarioOptions<G>(sc);
+        if (sc.rounds || sc.balance) {
+            if (!pool) pool.reset(new WorkStealingPool(threads ? threads : thread::hardware_concurrency()));
+            options.pool = pool.get();
+        }
+        writeResult(*out, grid, sc, grid.runCascade(options, traceFile.empty() ? nullptr : &tracer));
+    }
+    if (!trace.close()) {
+        cout << "Error writing trace: " << traceFile << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Write a margin as JSON: the exact increase, or null if it was not reached
+void writeMargin(ostream& out, double percent) {
+    if (percent < 0) out << "null";
+    else out << formatNumber(percent);
+}
+
+// Search the load margins of every scenario on every grid. Each scenario's
+// percentage is the largest increase searched. The searches run in parallel,
+// and results are written in grid, then scenario order.
+template <typename G>
+int runMargin(const string& scenarioFile, const vector<string>& gridFiles, double lossPercent, bool dcFlow,
+              bool rounds, bool balance, unsigned threads, const string& outFile) {
+    if (lossPercent <= 0 || lossPercent > 100) {
+        cout << "Error: Node loss must be > 0 and <= 100 percent.\n";
+        return 1;
+    }
+    vector<G> grids;
+    vector<vector<Scenario>> scenarios(gridFiles.size());
+    vector<pair<size_t, size_t>> tasks; // Grid and scenario index
+    grids.reserve(gridFiles.size());
+    for (size_t g = 0; g < gridFiles.size(); g++) {
+        grids.emplace_back(1);
+        grids[g].setVerbose(false);
+        if (!grids[g].loadGrid(gridFiles[g])) return 1;
+        if (!loadScenarios(scenarioFile, grids[g], dcFlow, rounds, balance, scenarios[g])) return 1;
+        bool anyDc = false;
+        for (size_t k = 0; k < scenarios[g].size(); k++) {
+            anyDc = anyDc || scenarios[g][k].dcFlow;
+            tasks.push_back({g, k});
+        }
+        grids[g].prepare(anyDc);
+    }
+    ModeOutput file;
+    ostream* out = openOutput(outFile, file);
+    if (!out) return 1;
+
+    WorkStealingPool pool(threads ? threads : thread::hardware_concurrency());
+    vector<MarginResult> results(tasks.size());
+    pool.parallelFor(tasks.size(), [&](unsigned, size_t k) {
+        const G& grid = grids[tasks[k].first];
+        typename G::GridState st = grid.getState();
+        results[k] = grid.findMargin(st, scenarioOptions<G>(scenarios[tasks[k].first][tasks[k].second]), lossPercent / 100.0);
+    });
+    for (size_t k = 0; k < tasks.size(); k++) {
+        const Scenario& sc = scenarios[tasks[k].first][tasks[k].second];
+        const MarginResult& r = results[k];
+        *out << "{\"grid\":\"" << jsonEscape(gridFiles[tasks[k].first]) << "\",\"scenario\":\"" << jsonEscape(sc.name)
+             << "\",\"mode\":\"" << (sc.randomLoad ? "random" : "uniform") << "\",\"limit\":" << sc.loadIncreasePercent;
+        if (sc.dcFlow) *out << ",\"flow\":\"dc\"";
+        if (sc.rounds) *out << ",\"cascade\":\"rounds\"";
+        if (sc.balance) *out << ",\"balance\":true";
+        *out << ",\"first_failure\":";
+        writeMargin(*out, r.firstFailure);
+        *out << ",\"islanding\":";
+        writeMargin(*out, r.islanding);
+        *out << ",\"node_loss\":";
+        writeMargin(*out, r.nodeLoss);
+        *out << ",\"node_loss_percent\":" << lossPercent << ",\"cascades\":" << r.cascades << "}\n";
+    }
+    return 0;
+}
+
+// Split a CSV line into its comma-separated fields, trimmed of spaces
+void splitFields(const TextCursor& line, vector<pair<const char*, const char*>>& fields) {
+    fields.clear();
+    const char* p = line.position();
+    const char* end = line.limit();
+    while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    if (p == end) return;
+    while (true) {
+        const char* comma = static_cast<const char*>(memchr(p, ',', end - p));
+        const char* a = p;
+        const char* b = comma ? comma : end;
+        while (a < b && (*a == ' ' || *a == '\t')) a++;
+        while (b > a && (b[-1] == ' ' || b[-1] == '\t')) b--;
+        fields.push_back({a, b});
+        if (!comma) return;
+        p = comma + 1;
+    }
+}
+
+// Stream a load profile through the grid. The profile is a CSV file whose
+// header names a time column and then nodes (by name) or lines (as u-v);
+// each row gives the absolute load in MW of those elements at one time step,
+// an empty cell keeping the previous value. Only the changed columns are
+// checked against their limits, and a cascade runs from the step's loads
+// only when some element crosses into overload. Steps are independent: the
+// grid is restored after each cascade, and rows are read in chunks, so memory
+// does not grow with the length of the profile.
+template <typename G>
+int runReplay(const string& gridFile, const string& profileFile, bool dcFlow, bool rounds, bool balance,
+              unsigned threads, const string& outFile) {
+    using Index = typename G::IndexType;
+    G grid(1);
+    grid.setVerbose(false);
+    if (!grid.loadGrid(gridFile)) return 1;
+    ChunkedLineReader reader(profileFile);
+    if (!reader.isOpen()) {
+        cout << "Error opening file: " << profileFile << "\n";
+        return 1;
+    }
+
+    // Header: the time column, then one node or line per column
+    TextCursor line(nullptr, nullptr);
+    vector<pair<const char*, const char*>> fields;
+    long long lineNo = 0;
+    while (fields.empty() && reader.next(line)) {
+        lineNo++;
+        splitFields(line, fields);
+    }
+    if (fields.size() < 2) {
+        cout << "Profile " << profileFile << " has no element columns.\n";
+        return 1;
+    }
+    unordered_map<string, Index> nodeByName;
+    for (Index i = 0; i < grid.getNumNodes(); i++) nodeByName.emplace(grid.getNodeName(i), i);
+    vector<Index> columns; // Node index, or ~line ID for a line
+    vector<char> usedNode(grid.getNumNodes(), 0), usedLine(grid.getNumLines(), 0);
+    for (size_t c = 1; c < fields.size(); c++) {
+        string name(fields[c].first, fields[c].second);
+        auto it = nodeByName.find(name);
+        vector<long long> ids;
+        if (it != nodeByName.end()) {
+            columns.push_back(it->second);
+        } else if (name.find(',') == string::npos && parseLineList(name, grid, ids) && ids.size() == 1) {
+            columns.push_back(~static_cast<Index>(ids[0]));
+        } else {
+            cout << "Unknown column '" << name << "' at line " << lineNo << ".\n";
+            return 1;
+        }
+        char& used = columns.back() >= 0 ? usedNode[columns.back()] : usedLine[~columns.back()];
+        if (used) {
+            cout << "Duplicate column '" << name << "' at line " << lineNo << ".\n";
+            return 1;
+        }
+        used = 1;
+    }
+
+    ModeOutput file;
+    ostream* out = openOutput(outFile, file);
+    if (!out) return 1;
+    grid.prepare(dcFlow);
+    typename G::CascadeOptions options;
+    options.loadIncreasePercent = 0;
+    options.dcFlow = dcFlow;
+    options.rounds = rounds;
+    options.balanceIslands = balance;
+    unique_ptr<WorkStealingPool> pool;
+    if (rounds || balance) {
+        pool.reset(new WorkStealingPool(threads ? threads : thread::hardware_concurrency()));
+        options.pool = pool.get();
+    }
+    typename G::GridState st = grid.getState();
+    vector<char> nodeOver(grid.getNumNodes(), 0), lineOver(grid.getNumLines(), 0);
+    vector<Index> crossedNodes, crossedLines, overloadedNodes, overloadedLines;
+    long long steps = 0, cascades = 0;
+    while (reader.next(line)) {
+        lineNo++;
+        splitFields(line, fields);
+        if (fields.empty()) continue;
+        if (fields.size() != columns.size() + 1) {
+            cout << "Expected " << columns.size() + 1 << " fields at line " << lineNo << ", found " << fields.size() << ".\n";
+            return 1;
+        }
+        // Apply the changed loads and note which elements crossed their limit
+        crossedNodes.clear();
+        crossedLines.clear();
+        for (size_t c = 0; c < columns.size(); c++) {
+            const char* a = fields[c + 1].first;
+            const char* b = fields[c + 1].second;
+            if (a == b) continue;
+            double load;
+            TextCursor cell(a, b);
+            if (!cell.number(load) || cell.position() != b || !(load >= 0)) {
+                cout << "Invalid load at line " << lineNo << ", column " << c + 2 << ".\n";
+                return 1;
+            }
+            Index k = columns[c];
+            if (k >= 0) {
+                st.nodeLoads[k] = load;
+                bool over = st.nodeActive[k] && load >= grid.getNodeCapacity(k);
+                if (over && !nodeOver[k]) crossedNodes.push_back(k);
+                nodeOver[k] = over;
+            } else {
+                st.lineLoads[~k] = load;
+                bool over = st.lineActive[~k] && load >= grid.getLineCapacity(~k);
+                if (over && !lineOver[~k]) crossedLines.push_back(~k);
+                lineOver[~k] = over;
+            }
+        }
+        if (steps == 0) {
+            // Everything already overloaded at the first step counts as crossing
+            grid.checkOverloads(st, overloadedNodes, overloadedLines);
+            crossedNodes = overloadedNodes;
+            crossedLines = overloadedLines;
+            for (Index i : overloadedNodes) nodeOver[i] = 1;
+            for (Index id : overloadedLines) lineOver[id] = 1;
+        }
+        if (!crossedNodes.empty() || !crossedLines.empty()) {
+            sort(crossedNodes.begin(), crossedNodes.end());
+            sort(crossedLines.begin(), crossedLines.end());
+            *out << "{\"step\":" << steps << ",\"time\":\"" << jsonEscape(string(fields[0].first, fields[0].second))
+                 << "\",\"crossed_nodes\":[";
+            for (size_t k = 0; k < crossedNodes.size(); k++) *out << (k ? "," : "") << crossedNodes[k];
+            *out << "],\"crossed_lines\":[";
+            for (size_t k = 0; k < crossedLines.size(); k++) {
+                const auto& l = grid.getLine(crossedLines[k]);
+                *out << (k ? ",[" : "[") << l.from << "," << l.to << "]";
+            }
+            *out << "]";
+            st.checkpoint();
+            writeCascade(*out, grid, grid.runCascade(st, options));
+            st.rollback();
+            cascades++;
+        }
+        steps++;
+    }
+    if (!outFile.empty()) cout << "Replayed " << steps << " steps, " << cascades << " cascades.\n";
+    return 0;
+}
+
+// Replay a binary trace as the interactive text log, or as one DOT graph of
+// the final state per cascade
+int runRenderTrace(const string& traceFile, const string& gridFile, bool dot, const string& outFile) {
+    Graph grid(1);
+    grid.setVerbose(false);
+    if (!grid.loadGrid(gridFile)) return 1;
+    MappedFile file;
+    if (!file.open(traceFile)) return 1;
+    TraceHeader header;
+    if (file.size() < sizeof(header) || memcmp(file.data(), traceMagic, 8) != 0) {
+        cout << "Not a cascade trace: " << traceFile << "\n";
+        return 1;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.version < 1 || header.version > traceVersion || header.recordSize != sizeof(TraceRecord)) {
+        cout << "Unsupported trace version " << header.version << " in " << traceFile << ".\n";
+        return 1;
+    }
+    if (header.numNodes != static_cast<uint64_t>(grid.getNumNodes()) || header.numLines != static_cast<uint64_t>(grid.getNumLines())) {
+        cout << "Trace " << traceFile << " was recorded on a grid with " << header.numNodes << " nodes and "
+             << header.numLines << " lines, not " << gridFile << ".\n";
+        return 1;
+    }
+    ModeOutput outStream;
+    ostream* out = openOutput(outFile, outStream);
+    if (!out) return 1;
+
+    // Rebuild each cascade's state and result from its records
+    size_t count = (file.size() - sizeof(header)) / sizeof(TraceRecord);
+    GridState st = grid.getState();
+    CascadeResult result;
+    int lastSplit = -1; // Event index of the IslandSplit that pieces belong to
+    ComponentLabels islands; // Final islands, found at the cascade's first Shed
+    bool islandsFound = false;
+    ConsoleObserver console(grid, st, *out, false);
+    CascadeObserver none;
+    CascadeObserver& show = dot ? none : console;
+    for (size_t k = 0; k < count; k++) {
+        TraceRecord r;
+        memcpy(&r, file.data() + sizeof(header) + k * sizeof(TraceRecord), sizeof(r));
+        bool ok = true;
+        switch (r.kind) {
+            case TraceRecord::Start:
+                st = grid.getState();
+                result = CascadeResult();
+                lastSplit = -1;
+                islandsFound = false;
+                show.onStart(r.x, r.flag != 0);
+                break;
+            case TraceRecord::NodeLoad:
+                ok = r.a >= 0 && r.a < grid.getNumNodes();
+                if (ok) {
+                    st.nodeLoads[r.a] = r.y;
+                    show.onNodeLoadIncrease(r.a, r.x, r.y, r.z);
+                }
+                break;
+            case TraceRecord::LineLoad:
+                ok = r.a >= 0 && r.a < grid.getNumLines();
+                if (ok) {
+                    st.lineLoads[r.a] = r.y;
+                    show.onLineLoadIncrease(r.a, r.x, r.y, r.z);
+                }
+                break;
+            case TraceRecord::OverloadCheck:
+                show.onOverloadCheck(r.a, r.b, r.flag != 0);
+                break;
+            case TraceRecord::Failure:
+                ok = r.a >= 0 ? r.a < grid.getNumNodes() && r.b == -1 : r.b >= 0 && r.b < grid.getNumLines();
+                if (ok) {
+                    if (r.a >= 0) st.setNodeActive(r.a, false);
+                    else st.setLineActive(r.b, false);
+                    result.events.push_back({r.a, r.b, r.x, r.y, r.flag != 0});
+                    show.onFailure(result.events.back());
+                }
+                break;
+            case TraceRecord::Redistribute:
+                ok = r.a >= 0 && r.a < grid.getNumNodes() && r.b >= 0 && r.b < grid.getNumLines();
+                if (ok) {
+                    st.lineLoads[r.b] += r.x;
+                    show.onRedistribute(r.a, r.b, r.x);
+                }
+                break;
+            case TraceRecord::NoSpareCapacity:
+                ok = r.a >= 0 && r.a < grid.getNumNodes();
+                if (ok) show.onNoSpareCapacity(r.a);
+                break;
+            case TraceRecord::IslandSplit:
+                ok = r.a >= 0 && static_cast<size_t>(r.a) < result.events.size();
+                if (ok) {
+                    result.timeline.resize(result.events.size(), IslandStep());
+                    result.timeline[r.a].islands = r.b;
+                    result.timeline[r.a].largest = static_cast<int>(r.x);
+                    lastSplit = r.a;
+                }
+                break;
+            case TraceRecord::IslandPiece:
+                ok = lastSplit != -1;
+                if (ok) result.timeline[lastSplit].pieces.push_back(r.a);
+                break;
+            case TraceRecord::DemandTransfer:
+                ok = r.a >= 0 && r.a < grid.getNumNodes() && r.b >= -1 && r.b < grid.getNumNodes();
+                if (ok) {
+                    st.nodeLoads[r.a] = 0;
+                    if (r.b >= 0) st.nodeLoads[r.b] += r.x;
+                    show.onDemandTransfer(r.a, r.b, r.x);
+                }
+                break;
+            case TraceRecord::Shed:
+                ok = r.a >= 0 && r.a < grid.getNumNodes() && r.x >= 0 && r.x <= 1;
+                if (ok && !islandsFound) {
+                    grid.findComponents(st, islands);
+                    islandsFound = true;
+                }
+                ok = ok && islands.label[r.a] != -1;
+                if (ok) {
+                    grid.shedIsland(st, islands, islands.label[r.a], r.x);
+                    show.onShed(r.a, r.x);
+                }
+                break;
+            case TraceRecord::Finish:
+                result.timeline.resize(result.events.size(), IslandStep());
+                show.onFinish(result);
+                if (dot) grid.writeDot(*out, st);
+                break;
+            default:
+                ok = false;
+        }
+        if (!ok) {
+            cout << "Invalid trace record " << k << " in " << traceFile << ".\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Write an N-1 screening report as one JSON object
+template <typename G>
+void writeScreen(ostream& out, const G& grid, const typename G::CriticalReport& report) {
+    out << "{\"critical_nodes\":[";
+    for (size_t i = 0; i < report.nodes.size(); i++) {
+        out << (i ? "," : "") << report.nodes[i];
+    }
+    out << "],\"critical_lines\":[";
+    for (size_t i = 0; i < report.lines.size(); i++) {
+        const auto& l = grid.getLine(report.lines[i].line);
+        out << (i ? "," : "") << "{\"line\":[" << l.from << "," << l.to << "],\"cause\":\""
+            << (report.lines[i].disconnects ? "disconnection" : "overloads") << "\"}";
+    }
+    out << "]}\n";
+}
+
+// Screen every N-1 outage in parallel and write the critical elements as JSON
+template <typename G>
+int runScreen(const string& gridFile, unsigned threads, const string& outFile) {
+    G grid(1);
+    grid.setVerbose(false);
+    if (!grid.loadGrid(gridFile)) return 1;
+    ModeOutput file;
+    ostream* out = openOutput(outFile, file);
+    if (!out) return 1;
+
+    WorkStealingPool pool(threads ? threads : thread::hardware_concurrency());
+    writeScreen(*out, grid, grid.analyzeCriticalComponents(&pool));
+    return 0;
+}
+
+// Write one element's Monte Carlo statistics as JSON fields
+void writeStats(ostream& out, const ElementStats& es, uint64_t trials) {
+    out << "\"failure_probability\":" << static_cast<double>(es.failures) / trials
+        << ",\"mean_cascade_size\":" << (es.failures ? static_cast<double>(es.cascadeSizeSum) / es.failures : 0.0)
+        << ",\"islanding_probability\":" << static_cast<double>(es.islanded) / trials;
+}
+
+// Estimate per-element failure and islanding probabilities from random-load trials
+template <typename G>
+int runMonteCarlo(const string& gridFile, double percent, int trials, uint64_t seed, bool dcFlow, bool rounds,
+                  bool balance, unsigned threads, const string& outFile) {
+    using Index = typename G::IndexType;
+    if (percent < 0 || trials <= 0) {
+        cout << "Error: Load increase must be >= 0 and trials > 0.\n";
+        return 1;
+    }
+    G grid(1);
+    grid.setVerbose(false);
+    if (!grid.loadGrid(gridFile)) return 1;
+    ModeOutput file;
+    ostream* out = openOutput(outFile, file);
+    if (!out) return 1;
+
+    WorkStealingPool pool(threads ? threads : thread::hardware_concurrency());
+    typename G::CascadeOptions options;
+    options.loadIncreasePercent = percent;
+    options.randomLoad = true;
+    options.seed = seed;
+    options.dcFlow = dcFlow;
+    options.rounds = rounds; // Trials already fill the pool, so rounds run on the trial's thread
+    options.balanceIslands = balance;
+    MonteCarloSummary summary = grid.runMonteCarlo(options, trials, &pool);
+
+    *out << "{\"trials\":" << summary.trials << ",\"seed\":" << seed << ",\"percent\":" << percent;
+    if (rounds) *out << ",\"cascade\":\"rounds\"";
+    *out
+         << ",\"mean_failures\":" << static_cast<double>(summary.totalFailures) / summary.trials
+         << ",\"islanding_probability\":" << static_cast<double>(summary.islandedTrials) / summary.trials;
+    if (balance) {
+        *out << ",\"balance\":true,\"shedding_probability\":" << static_cast<double>(summary.sheddingTrials) / summary.trials
+             << ",\"blackout_probability\":" << static_cast<double>(summary.blackoutTrials) / summary.trials;
+    }
+    *out << ",\"nodes\":[";
+    for (Index i = 0; i < grid.getNumNodes(); i++) {
+        *out << (i ? "," : "") << "{\"node\":\"" << jsonEscape(grid.getNodeName(i)) << "\",";
+        writeStats(*out, summary.nodes[i], summary.trials);
+        *out << "}";
+    }
+    *out << "],\"lines\":[";
+    for (Index id = 0; id < grid.getNumLines(); id++) {
+        const auto& l = grid.getLine(id);
+        *out << (id ? "," : "") << "{\"line\":[" << l.from << "," << l.to << "],";
+        writeStats(*out, summary.lines[id], summary.trials);
+        *out << "}";
+    }
+    *out << "]}\n";
+    return 0;
+}
+
+// Convert a grid between formats. A snapshot is written unless the input is
+// already one or the output name ends in .txt.
+int runConvert(const string& inFile, const string& outFile) {
+    Graph grid(1);
+    grid.setVerbose(false);
+    bool toText = GridView::isSnapshot(inFile)
+                  || (outFile.size() > 4 && outFile.compare(outFile.size() - 4, 4, ".txt") == 0);
+    if (!grid.loadGrid(inFile)) return 1;
+    if (toText) return grid.saveGrid(outFile) ? 0 : 1;
+    return grid.saveSnapshot(outFile) ? 0 : 1;
+}
+
+// Write the base state of a grid as one JSON object
+void writeState(ostream& out, const Graph& grid) {
+    const GridState& st = grid.getState();
+    out << "{\"nodes\":[";
+    for (int i = 0; i < grid.getNumNodes(); i++) {
+        out << (i ? ",{" : "{") << "\"name\":\"" << jsonEscape(grid.getNodeName(i)) << "\",\"load\":"
+            << formatNumber(st.nodeLoads[i]) << ",\"capacity\":" << formatNumber(grid.getNodeCapacity(i))
+            << ",\"active\":" << (st.nodeActive[i] ? "true" : "false") << "}";
+    }
+    out << "],\"lines\":[";
+    for (int id = 0; id < grid.getNumLines(); id++) {
+        const Line& l = grid.getLine(id);
+        out << (id ? ",{" : "{") << "\"from\":" << l.from << ",\"to\":" << l.to << ",\"load\":"
+            << formatNumber(st.lineLoads[id]) << ",\"capacity\":" << formatNumber(grid.getLineCapacity(id))
+            << ",\"reactance\":" << formatNumber(l.reactance) << ",\"active\":" << (st.lineActive[id] ? "true" : "false") << "}";
+    }
+    out << "]}\n";
+}
+
+#ifndef _WIN32
+// One HTTP request or response of the simulation server
+struct HttpRequest {
+    string method, path;
+    map<string, string> query;
+    string origin; // Origin header sent by browsers, lowercased; empty if absent
+    string body;
+};
+
+struct HttpResponse {
+    int status = 200;
+    string type = "application/json";
+    string body;
+};
+
+HttpResponse jsonError(int status, const string& message) {
+    return {status, "application/json", "{\"error\":\"" + jsonEscape(message) + "\"}\n"};
+}
+
+// Decode %XX escapes and '+' in a URL component
+string urlDecode(const string& text) {
+    string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1]))
+            && isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+// Keeps grids resident and answers requests against them. Connection threads
+// queue requests; one dispatcher takes everything queued as a batch, applies
+// its grid loads and unloads in arrival order, then runs the batch's cascades
+// together on the pool. Queries only read the resident grids, so they never
+// reparse a grid or copy more than its state.
+class GridServer {
+private:
+    struct Job {
+        const HttpRequest* request;
+        HttpResponse response;
+        bool done = false;
+    };
+    struct Resident {
+        Graph grid{1};
+        string screen; // Cached N-1 report
+    };
+    // One scenario of a simulate request. Tasks and screens share ownership
+    // of their grid, so a later request of the batch may replace or delete it.
+    struct Task {
+        size_t job;
+        shared_ptr<const Resident> resident;
+        Scenario scenario;
+        string result;
+    };
+
+    mutex lock;
+    condition_variable queued, answered;
+    vector<Job*> queue;
+    map<string, shared_ptr<Resident>> grids; // Touched only by the dispatcher
+    WorkStealingPool& pool;
+    string fileRoot; // Directory ?file= loads from, resolved; empty if ?file= is refused
+    uint64_t requests = 0, batches = 0;
+    static constexpr size_t maxBatch = 256;
+
+    static string summary(const string& name, const Graph& grid) {
+        return "{\"name\":\"" + jsonEscape(name) + "\",\"nodes\":" + to_string(grid.getNumNodes()) + ",\"lines\":"
+               + to_string(grid.getNumLines()) + ",\"components\":" + to_string(grid.findComponents().count()) + "}";
+    }
+
+    // Resolve a ?file= path, relative to the file root or absolute, to a file
+    // inside the root; false with error set otherwise
+    bool resolveFile(const string& name, string& path, string& error) const {
+        if (fileRoot.empty()) {
+            error = "Loading files is disabled; start the server with --files DIR";
+            return false;
+        }
+        string joined = !name.empty() && name[0] == '/' ? name : fileRoot + "/" + name;
+        char* real = realpath(joined.c_str(), nullptr);
+        if (!real) {
+            error = "Cannot open " + name;
+            return false;
+        }
+        path = real;
+        free(real);
+        if (fileRoot != "/" && path != fileRoot && path.compare(0, fileRoot.size() + 1, fileRoot + "/") != 0) {
+            error = name + " is outside the server's file root";
+            return false;
+        }
+        return true;
+    }
+
+    // PUT /grids/NAME: load the body (text format) or ?file=PATH (any format)
+    HttpResponse load(const string& name, const HttpRequest& req) {
+        auto file = req.query.find("file");
+        string path;
+        if (file != req.query.end()) {
+            string error;
+            if (!resolveFile(file->second, path, error)) return jsonError(403, error);
+        }
+        shared_ptr<Resident> resident = make_shared<Resident>();
+        resident->grid.setVerbose(false);
+        ostringstream text;
+        resident->grid.setMessages(text);
+        bool ok = !path.empty() ? resident->grid.loadGrid(path) : resident->grid.loadText(req.body.data(), req.body.size());
+        resident->grid.setMessages(cout);
+        string message = text.str();
+        while (!message.empty() && message.back() == '\n') message.pop_back();
+        if (!ok) return jsonError(400, message.empty() ? "Invalid grid" : message);
+        resident->grid.prepare(false);
+        bool replaced = grids.count(name) > 0;
+        grids[name] = move(resident);
+        return {replaced ? 200 : 201, "application/json", summary(name, grids[name]->grid) + "\n"};
+    }
+
+    // Answer everything but cascades and screening, which dispatch() batches
+    HttpResponse answer(const HttpRequest& req, const vector<string>& parts) {
+        if (parts.size() == 1 && parts[0] == "health" && req.method == "GET") {
+            return {200, "application/json", "{\"status\":\"ok\",\"grids\":" + to_string(grids.size()) + ",\"requests\":"
+                                             + to_string(requests) + ",\"batches\":" + to_string(batches) + "}\n"};
+        }
+        if (parts.size() == 1 && parts[0] == "metrics" && req.method == "GET") {
+#if GRID_METRICS
+            ostringstream text;
+            writeMetricsPrometheus(text, Metrics::total());
+            return {200, "text/plain; version=0.0.4", text.str()};
+#else
+            return jsonError(404, "Metrics are compiled out of this build");
+#endif
+        }
+        if (parts.empty() || parts[0] != "grids" || parts.size() > 3) return jsonError(404, "No such resource");
+        if (parts.size() == 1) {
+            if (req.method != "GET") return jsonError(405, "Use GET");
+            string body = "[";
+            for (const auto& g : grids) body += (body.size() > 1 ? "," : "") + summary(g.first, g.second->grid);
+            return {200, "application/json", body + "]\n"};
+        }
+        const string& name = parts[1];
+        if (parts.size() == 2 && (req.method == "PUT" || req.method == "POST")) return load(name, req);
+        auto it = grids.find(name);
+        if (it == grids.end()) return jsonError(404, "No grid named " + name);
+        const Graph& grid = it->second->grid;
+        if (parts.size() == 2) {
+            if (req.method == "DELETE") {
+                grids.erase(it);
+                return {204, "application/json", ""};
+            }
+            if (req.method != "GET") return jsonError(405, "Use GET, PUT or DELETE");
+            return {200, "application/json", summary(name, grid) + "\n"};
+        }
+        if (parts[2] == "state" && req.method == "GET") {
+            ostringstream text;
+            writeState(text, grid);
+            return {200, "application/json", text.str()};
+        }
+        return jsonError(404, "No such resource");
+    }
+
+    // Scenarios of a simulate request: the body in the batch scenario format,
+    // or a single scenario from the query (mode, percent, seed, nodes, lines, flow, cascade, balance)
+    bool parseSimulate(const HttpRequest& req, const Graph& grid, vector<Scenario>& scenarios, string& error) {
+        string text = req.body;
+        if (text.find_first_not_of(" \t\r\n") == string::npos) {
+            auto get = [&](const string& key, const string& fallback) {
+                auto it = req.query.find(key);
+                return it == req.query.end() ? fallback : it->second;
+            };
+            text = get("name", "request") + " " + get("mode", "uniform") + " " + get("percent", "0");
+            for (const char* key : {"seed", "nodes", "lines", "flow", "cascade", "balance"}) {
+                if (req.query.count(key)) text += string(" ") + key + "=" + req.query.at(key);
+            }
+        }
+        istringstream in(text);
+        ostringstream err;
+        bool ok = parseScenarios(in, grid, false, false, false, scenarios, err);
+        error = err.str();
+        while (!error.empty() && error.back() == '\n') error.pop_back();
+        return ok;
+    }
+
+    void dispatch(vector<Job*>& batch) {
+        vector<Task> tasks;
+        vector<pair<size_t, shared_ptr<Resident>>> screens;
+        for (size_t j = 0; j < batch.size(); j++) {
+            const HttpRequest& req = *batch[j]->request;
+            vector<string> parts;
+            istringstream path(req.path);
+            string part;
+            while (getline(path, part, '/')) {
+                if (!part.empty()) parts.push_back(urlDecode(part));
+            }
+            bool simulate = parts.size() == 3 && parts[0] == "grids" && parts[2] == "simulate";
+            bool screen = parts.size() == 3 && parts[0] == "grids" && parts[2] == "contingency";
+            if (!simulate && !screen) {
+                batch[j]->response = answer(req, parts);
+                continue;
+            }
+            auto it = grids.find(parts[1]);
+            if (it == grids.end()) {
+                batch[j]->response = jsonError(404, "No grid named " + parts[1]);
+            } else if (screen) {
+                if (req.method != "GET") batch[j]->response = jsonError(405, "Use GET");
+                else screens.push_back({j, it->second});
+            } else if (req.method != "POST") {
+                batch[j]->response = jsonError(405, "Use POST");
+            } else {
+                vector<Scenario> scenarios;
+                string error;
+                if (!parseSimulate(req, it->second->grid, scenarios, error)) {
+                    batch[j]->response = jsonError(400, error);
+                    continue;
+                }
+                batch[j]->response = {200, "application/x-ndjson", ""};
+                for (const Scenario& sc : scenarios) {
+                    if (sc.dcFlow) it->second->grid.prepare(true);
+                    tasks.push_back({j, it->second, sc, ""});
+                }
+            }
+        }
+
+        // Every cascade of the batch at once, then the answers in scenario order
+        pool.parallelFor(tasks.size(), [&](unsigned, size_t k) {
+            const Graph& grid = tasks[k].resident->grid;
+            GridState st = grid.getState();
+            ostringstream text;
+            writeResult(text, grid, tasks[k].scenario, grid.runCascade(st, scenarioOptions<Graph>(tasks[k].scenario)));
+            tasks[k].result = text.str();
+        });
+        for (Task& t : tasks) batch[t.job]->response.body += t.result;
+
+        // Screening parallelizes over outages itself, so reports run one at a time
+        for (const auto& s : screens) {
+            Resident& r = *s.second;
+            if (r.screen.empty()) {
+                ostringstream text;
+                writeScreen(text, r.grid, r.grid.analyzeCriticalComponents(&pool));
+                r.screen = text.str();
+            }
+            batch[s.first]->response = {200, "application/json", r.screen};
+        }
+    }
+
+public:
+    GridServer(WorkStealingPool& workers, const string& files) : pool(workers), fileRoot(files) {}
+
+    // Called from connection threads; blocks until the dispatcher answers
+    HttpResponse submit(const HttpRequest& req) {
+        Job job{&req, {}, false};
+        unique_lock<mutex> guard(lock);
+        queue.push_back(&job);
+        queued.notify_one();
+        answered.wait(guard, [&] { return job.done; });
+        return move(job.response);
+    }
+
+    // Dispatcher loop; never returns
+    void run() {
+        while (true) {
+            vector<Job*> batch;
+            {
+                unique_lock<mutex> guard(lock);
+                queued.wait(guard, [&] { return !queue.empty(); });
+                size_t n = min(queue.size(), maxBatch);
+                batch.assign(queue.begin(), queue.begin() + n);
+                queue.erase(queue.begin(), queue.begin() + n);
+            }
+            requests += batch.size();
+            batches++;
+            dispatch(batch);
+            lock_guard<mutex> guard(lock);
+            for (Job* job : batch) job->done = true;
+            answered.notify_all();
+        }
+    }
+};
+
+// Largest request body accepted, enough for a text grid of a few million lines
+const size_t maxRequestBody = size_t(1) << 30;
+
+// Read one request from a connection into req; false once the peer closes
+// the connection or sends something that is not HTTP/1.x. error is set to a
+// response to send before closing when the request was malformed.
+bool readRequest(int fd, string& pending, HttpRequest& req, bool& keepAlive, HttpResponse& error) {
+    error.status = 0;
+    req.origin.clear();
+    auto fill = [&]() {
+        char chunk[65536];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        pending.append(chunk, n);
+        return true;
+    };
+    size_t headerEnd;
+    while ((headerEnd = pending.find("\r\n\r\n")) == string::npos) {
+        if (pending.size() > 65536) {
+            error = jsonError(400, "Request header too large");
+            return false;
+        }
+        if (!fill()) return false;
+    }
+    istringstream head(pending.substr(0, headerEnd));
+    string line, target, version;
+    getline(head, line);
+    istringstream first(line);
+    if (!(first >> req.method >> target >> version) || version.compare(0, 7, "HTTP/1.") != 0) {
+        error = jsonError(400, "Malformed request line");
+        return false;
+    }
+    keepAlive = version != "HTTP/1.0";
+    size_t bodySize = 0;
+    while (getline(head, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t colon = line.find(':');
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon), value = line.substr(colon + 1);
+        transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        value.erase(0, value.find_first_not_of(" \t"));
+        transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (key == "content-length") {
+            istringstream is(value);
+            if (!(is >> bodySize)) {
+                error = jsonError(400, "Invalid Content-Length");
+                return false;
+            }
+        } else if (key == "transfer-encoding" && value != "identity") {
+            error = jsonError(411, "Send the body with a Content-Length");
+            return false;
+        } else if (key == "connection") {
+            keepAlive = value == "keep-alive" || (keepAlive && value != "close");
+        } else if (key == "origin") {
+            req.origin = value;
+        }
+    }
+    if (bodySize > maxRequestBody) {
+        error = jsonError(413, "Request body too large");
+        return false;
+    }
+    pending.erase(0, headerEnd + 4);
+    while (pending.size() < bodySize) {
+        if (!fill()) return false;
+    }
+    req.body = pending.substr(0, bodySize);
+    pending.erase(0, bodySize);
+
+    size_t q = target.find('?');
+    req.path = target.substr(0, q);
+    req.query.clear();
+    if (q != string::npos) {
+        istringstream query(target.substr(q + 1));
+        string pair;
+        while (getline(query, pair, '&')) {
+            size_t eq = pair.find('=');
+            req.query[urlDecode(pair.substr(0, eq))] = eq == string::npos ? "" : urlDecode(pair.substr(eq + 1));
+        }
+    }
+    return true;
+}
+
+bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+        GRID_COUNT(BytesWritten, n);
+    }
+    return true;
+}
+
+// origin, if set, is the one browser origin allowed to read responses
+bool sendResponse(int fd, const HttpResponse& r, bool keepAlive, const string& origin) {
+    static const map<int, const char*> reasons = {
+        {200, "OK"}, {201, "Created"}, {204, "No Content"}, {400, "Bad Request"}, {403, "Forbidden"}, {404, "Not Found"},
+        {405, "Method Not Allowed"}, {411, "Length Required"}, {413, "Payload Too Large"}};
+    auto reason = reasons.find(r.status);
+    string head = "HTTP/1.1 " + to_string(r.status) + " " + (reason == reasons.end() ? "Error" : reason->second)
+                  + "\r\nContent-Type: " + r.type + "\r\nContent-Length: " + to_string(r.body.size())
+                  + (origin.empty() ? "" : "\r\nAccess-Control-Allow-Origin: " + origin)
+                  + "\r\nConnection: " + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+    return sendAll(fd, head + r.body);
+}
+
+// Serve requests on one connection until the client closes it. Requests
+// from a browser page of any origin but the allowed one are refused before
+// they run, since a simple cross-origin POST needs no preflight.
+void serveConnection(int fd, GridServer& server, const string& origin) {
+    string pending;
+    HttpRequest req;
+    HttpResponse error;
+    bool keepAlive = true;
+    while (keepAlive && readRequest(fd, pending, req, keepAlive, error)) {
+        if (!req.origin.empty() && req.origin != origin) {
+            if (!sendResponse(fd, jsonError(403, "Origin not allowed; start the server with --origin"), keepAlive, "")) break;
+            continue;
+        }
+        if (req.method == "OPTIONS") {
+            // CORS preflight from the allowed browser front end
+            sendAll(fd, "HTTP/1.1 204 No Content\r\nAccess-Control-Allow-Origin: " + origin + "\r\n"
+                        "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+                        "Access-Control-Allow-Headers: Content-Type\r\nContent-Length: 0\r\n\r\n");
+            continue;
+        }
+        if (!sendResponse(fd, server.submit(req), keepAlive, origin)) break;
+    }
+    if (error.status) sendResponse(fd, error, false, origin);
+    close(fd);
+}
+
+// Serve the HTTP API on localhost:port, or on a Unix socket if a path is
+// given. origin is the browser origin allowed to call it, and fileRoot the
+// directory ?file= may load from; either is off when empty.
+int runServe(int port, const string& socketPath, unsigned threads, const string& origin, const string& fileRoot) {
+    signal(SIGPIPE, SIG_IGN);
+    string files;
+    if (!fileRoot.empty()) {
+        char* real = realpath(fileRoot.c_str(), nullptr);
+        struct stat info;
+        if (!real || stat(real, &info) != 0 || !S_ISDIR(info.st_mode)) {
+            cout << "Not a directory: " << fileRoot << "\n";
+            free(real);
+            return 1;
+        }
+        files = real;
+        free(real);
+    }
+    int listener;
+    if (!socketPath.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(addr.sun_path)) {
+            cout << "Socket path too long: " << socketPath << "\n";
+            return 1;
+        }
+        strcpy(addr.sun_path, socketPath.c_str());
+        struct stat info;
+        if (stat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) unlink(socketPath.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            cout << "Cannot listen on " << socketPath << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+    } else {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        if (listener >= 0) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            cout << "Cannot listen on port " << port << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+    }
+    if (listen(listener, 128) != 0) {
+        cout << "Cannot listen: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    WorkStealingPool pool(threads ? threads : thread::hardware_concurrency());
+    GridServer server(pool, files);
+    thread dispatcher(&GridServer::run, &server);
+    if (socketPath.empty()) cout << "Serving on http://127.0.0.1:" << port << "\n" << flush;
+    else cout << "Serving on " << socketPath << "\n" << flush;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cout << "Accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+        thread(serveConnection, fd, ref(server), origin).detach();
+    }
+    close(listener);
+    dispatcher.detach();
+    return 1;
+}
+#else
+int runServe(int, const string&, unsigned, const string&, const string&) {
+    cout << "--serve needs POSIX sockets and is not available on Windows.\n";
+    return 1;
+}
+#endif
+
+void printUsage(const char* prog) {
+    cout << "Usage:\n"
+         << "  " << prog << "                                  Interactive mode\n"
+         << "  " << prog << " --batch GRID SCENARIOS [--dc] [--rounds] [--balance] [-t N] [-o OUT] [--trace TRACE]\n"
+         << "        Run scenario file, write JSON Lines and optionally a binary event trace\n"
+         << "  " << prog << " --margin SCENARIOS GRID... [--loss PCT] [--dc] [--rounds] [--balance] [-t N] [-o OUT]\n"
+         << "        Find the load increases that start failures, islanding and PCT% node loss (default 50)\n"
+         << "  " << prog << " --replay GRID PROFILE [--dc] [--rounds] [--balance] [-t N] [-o OUT]\n"
+         << "        Stream a CSV load profile, cascading at each step where an element crosses its limit\n"
+         << "  " << prog << " --render-trace TRACE GRID [--dot] [-o OUT]\n"
+         << "        Print a trace as the interactive log, or as DOT graphs of each final state\n"
+         << "  " << prog << " --screen GRID [-t N] [-o OUT]    Parallel N-1 screening, write JSON\n"
+         << "  " << prog << " --montecarlo GRID PERCENT TRIALS [--dc] [--rounds] [--balance] [-s SEED] [-t N] [-o OUT]\n"
+         << "        Random-load Monte Carlo, write failure and islanding statistics as JSON\n"
+         << "  " << prog << " --convert IN OUT                 Convert between text, snapshot and MATPOWER (.m) input\n"
+         << "  " << prog << " --serve [--port N | --socket PATH] [--origin ORIGIN] [--files DIR] [-t N]\n"
+         << "        Keep grids resident and answer simulation requests over HTTP on localhost (default port 8765)\n"
+         << "Options:\n"
+         << "  -o OUT  Write results to OUT instead of standard output\n"
+         << "  -t N    Worker threads (default: all cores)\n"
+         << "  -s SEED Random seed (default: 1); results do not depend on -t\n"
+         << "  --dc    Move a failed line's flow by DC power flow (LODF) instead of to adjacent lines.\n"
+         << "        Each line's load is taken as a flow from its first node to its second, so a text\n"
+         << "        grid must list every line in its flow direction; MATPOWER cases follow the sign of PF\n"
+         << "  --rounds  Fail every overloaded element of a round together instead of one at a time\n"
+         << "  --balance Failed nodes trip their lines and pass on their demand; islands shed load to match generation\n"
+         << "  --preset standard|fast|huge  Engine types for --batch, --margin, --replay, --screen and --montecarlo:\n"
+         << "        double loads and 32-bit indices (default), float loads (fast), or 64-bit indices (huge)\n"
+         << "  --metrics FILE  Write run metrics to FILE: Prometheus text if it ends in .prom, else JSON\n"
+         << "  --origin ORIGIN  Browser origin (e.g. http://localhost:3000) allowed to call the server;\n"
+         << "        requests from any other web page are refused\n"
+         << "  --files DIR  Let PUT /grids/NAME?file=PATH load files under DIR; refused without it\n";
+}
+
+// Write the metrics gathered over the run, in Prometheus text format for a
+// .prom file and as JSON otherwise
+int writeMetrics(const string& metricsFile) {
+#if GRID_METRICS
+    ofstream out(metricsFile);
+    if (!out) {
+        cout << "Error opening file: " << metricsFile << "\n";
+        return 1;
+    }
+    MetricsTotals totals = Metrics::total();
+    bool prometheus = metricsFile.size() > 5 && metricsFile.compare(metricsFile.size() - 5, 5, ".prom") == 0;
+    if (prometheus) writeMetricsPrometheus(out, totals);
+    else writeMetricsJson(out, totals);
+    return 0;
+#else
+    cout << "Cannot write " << metricsFile << ": this build has GRID_METRICS=0.\n";
+    return 1;
+#endif
+}
+
+// Call run with a null pointer to the engine instantiation named by --preset
+template <typename Run>
+int withPreset(const string& preset, Run run) {
+    if (preset == "fast") return run(static_cast<FastGraph*>(nullptr));
+    if (preset == "huge") return run(static_cast<HugeGraph*>(nullptr));
+    return run(static_cast<Graph*>(nullptr));
+}
+
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        string mode = argv[1];
+        vector<string> args;
+        string outFile, traceFile, metricsFile, socketPath, origin, fileRoot, preset = "standard";
+        unsigned threads = 0;
+        bool dot = false, dcFlow = false, rounds = false, balance = false;
+        uint64_t seed = 1;
+        double lossPercent = 50;
+        int port = 8765;
+        bool ok = true;
+        for (int i = 2; i < argc && ok; i++) {
+            string arg = argv[i];
+            if (arg == "-o" && i + 1 < argc) {
+                outFile = argv[++i];
+            } else if (arg == "-t" && i + 1 < argc) {
+                istringstream is(argv[++i]);
+                ok = static_cast<bool>(is >> threads) && is.eof();
+            } else if (arg == "--trace" && i + 1 < argc) {
+                traceFile = argv[++i];
+            } else if (arg == "--metrics" && i + 1 < argc) {
+                metricsFile = argv[++i];
+            } else if (arg == "--dot") {
+                dot = true;
+            } else if (arg == "--dc") {
+                dcFlow = true;
+            } else if (arg == "--rounds") {
+                rounds = true;
+            } else if (arg == "--balance") {
+                balance = true;
+            } else if (arg == "-s" && i + 1 < argc) {
+                istringstream is(argv[++i]);
+                ok = static_cast<bool>(is >> seed) && is.eof();
+            } else if (arg == "--port" && i + 1 < argc) {
+                istringstream is(argv[++i]);
+                ok = static_cast<bool>(is >> port) && is.eof() && port > 0 && port < 65536;
+            } else if (arg == "--socket" && i + 1 < argc) {
+                socketPath = argv[++i];
+            } else if (arg == "--origin" && i + 1 < argc) {
+                origin = argv[++i];
+                transform(origin.begin(), origin.end(), origin.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+            } else if (arg == "--files" && i + 1 < argc) {
+                fileRoot = argv[++i];
+            } else if (arg == "--preset" && i + 1 < argc) {
+                preset = argv[++i];
+                ok = preset == "standard" || preset == "fast" || preset == "huge";
+            } else if (arg == "--loss" && i + 1 < argc) {
+                istringstream is(argv[++i]);
+                ok = static_cast<bool>(is >> lossPercent) && is.eof();
+            } else {
+                args.push_back(arg);
+            }
+        }
+        int status = -1; // Exit status once a mode has run
+        if (ok && mode == "--batch" && args.size() == 2) {
+            status = withPreset(preset, [&](auto* engine) {
+                return runBatch<remove_pointer_t<decltype(engine)>>(args[0], args[1], dcFlow, rounds, balance, threads,
+                                                                   outFile, traceFile);
+            });
+        }
+        if (ok && mode == "--margin" && args.size() >= 2) {
+            status = withPreset(preset, [&](auto* engine) {
+                return runMargin<remove_pointer_t<decltype(engine)>>(args[0], vector<string>(args.begin() + 1, args.end()),
+                                                                    lossPercent, dcFlow, rounds, balance, threads, outFile);
+            });
+        }
+        if (ok && mode == "--replay" && args.size() == 2) {
+            status = withPreset(preset, [&](auto* engine) {
+                return runReplay<remove_pointer_t<decltype(engine)>>(args[0], args[1], dcFlow, rounds, balance, threads, outFile);
+            });
+        }
+        if (ok && mode == "--render-trace" && args.size() == 2) status = runRenderTrace(args[0], args[1], dot, outFile);
+        if (ok && mode == "--screen" && args.size() == 1) {
+            status = withPreset(preset, [&](auto* engine) {
+                return runScreen<remove_pointer_t<decltype(engine)>>(args[0], threads, outFile);
+            });
+        }
+        if (ok && mode == "--convert" && args.size() == 2) status = runConvert(args[0], args[1]);
+        if (ok && mode == "--serve" && args.empty()) status = runServe(port, socketPath, threads, origin, fileRoot);
+        if (ok && mode == "--montecarlo" && args.size() == 3) {
+            double percent;
+            int trials;
+            istringstream ps(args[1]), ts(args[2]);
+            if ((ps >> percent) && ps.eof() && (ts >> trials) && ts.eof()) {
+                status = withPreset(preset, [&](auto* engine) {
+                    return runMonteCarlo<remove_pointer_t<decltype(engine)>>(args[0], percent, trials, seed, dcFlow, rounds,
+                                                                            balance, threads, outFile);
+                });
+            }
+        }
+        if (status >= 0) {
+            if (!metricsFile.empty() && writeMetrics(metricsFile) != 0) return 1;
+            return status;
+        }
+        printUsage(argv[0]);
+        return mode == "--help" || mode == "-h" ? 0 : 1;
+    }
     cout << "Electric Grid Failure Prediction\n";
     int numNodes;
     cout << "Enter number of nodes (substations): ";